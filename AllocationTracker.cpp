@@ -0,0 +1,193 @@
+﻿#include "AllocationTracker.h"
+#include <atomic>
+#include <iomanip>
+
+namespace {
+
+const size_t PHASE_COUNT = static_cast<size_t>(AllocationPhase::COUNT);
+
+const char* phaseName(AllocationPhase phase) {
+    switch (phase) {
+    case AllocationPhase::TOKENIZER: return "tokenizer";
+    case AllocationPhase::PARSER:    return "parser/codegen";
+    case AllocationPhase::WRITER:    return "writer";
+    default:                         return "other";
+    }
+}
+
+}
+
+#ifdef JACKC_TRACK_ALLOCATIONS
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+struct PhaseCounters {
+    std::atomic<size_t> allocations{ 0 };
+    std::atomic<size_t> bytes{ 0 };
+    std::atomic<long long> liveBytes{ 0 };
+    std::atomic<long long> peakBytes{ 0 };
+};
+
+PhaseCounters phases[PHASE_COUNT];
+PhaseCounters overall;
+thread_local AllocationPhase currentPhase = AllocationPhase::OTHER;
+
+// Заголовок перед каждым блоком: размер и этап выделения
+struct alignas(alignof(std::max_align_t)) BlockHeader {
+    size_t size;
+    AllocationPhase phase;
+};
+
+void raisePeak(std::atomic<long long>& peak, long long live) {
+    long long seen = peak.load(std::memory_order_relaxed);
+    while (live > seen && !peak.compare_exchange_weak(seen, live, std::memory_order_relaxed)) {
+    }
+}
+
+void account(PhaseCounters& counters, long long delta) {
+    if (delta > 0) {
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(static_cast<size_t>(delta), std::memory_order_relaxed);
+    }
+    long long live = counters.liveBytes.fetch_add(delta, std::memory_order_relaxed) + delta;
+    if (delta > 0) raisePeak(counters.peakBytes, live);
+}
+
+void* trackedAllocate(size_t size) noexcept {
+    BlockHeader* header = static_cast<BlockHeader*>(std::malloc(sizeof(BlockHeader) + size));
+    if (header == nullptr) return nullptr;
+    header->size = size;
+    header->phase = currentPhase;
+    long long delta = static_cast<long long>(size);
+    account(phases[static_cast<size_t>(header->phase)], delta);
+    account(overall, delta);
+    return header + 1;
+}
+
+void trackedFree(void* pointer) noexcept {
+    if (pointer == nullptr) return;
+    BlockHeader* header = static_cast<BlockHeader*>(pointer) - 1;
+    long long delta = -static_cast<long long>(header->size);
+    account(phases[static_cast<size_t>(header->phase)], delta);
+    account(overall, delta);
+    std::free(header);
+}
+
+void* allocateOrThrow(size_t size) {
+    void* pointer = trackedAllocate(size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+AllocationCounters snapshot(const PhaseCounters& counters) {
+    AllocationCounters result;
+    result.allocations = counters.allocations.load(std::memory_order_relaxed);
+    result.bytes = counters.bytes.load(std::memory_order_relaxed);
+    result.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+    result.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+    return result;
+}
+
+void resetCounters(PhaseCounters& counters) {
+    counters.allocations = 0;
+    counters.bytes = 0;
+    counters.peakBytes = counters.liveBytes.load(std::memory_order_relaxed);
+}
+
+}
+
+// Выровненные варианты (align_val_t) не заменяются: они и их delete
+// остаются стандартными и в учёт не попадают
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAllocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAllocate(size); }
+void operator delete(void* pointer) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, size_t) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { trackedFree(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { trackedFree(pointer); }
+
+AllocationScope::AllocationScope(AllocationPhase phase) : previous(currentPhase) {
+    currentPhase = phase;
+}
+
+AllocationScope::~AllocationScope() {
+    currentPhase = previous;
+}
+
+bool AllocationTracker::available() {
+    return true;
+}
+
+void AllocationTracker::reset() {
+    for (auto& counters : phases) {
+        resetCounters(counters);
+    }
+    resetCounters(overall);
+}
+
+AllocationCounters AllocationTracker::counters(AllocationPhase phase) {
+    return snapshot(phases[static_cast<size_t>(phase)]);
+}
+
+AllocationCounters AllocationTracker::total() {
+    return snapshot(overall);
+}
+
+#else
+
+bool AllocationTracker::available() {
+    return false;
+}
+
+void AllocationTracker::reset() {
+}
+
+AllocationCounters AllocationTracker::counters(AllocationPhase) {
+    return AllocationCounters();
+}
+
+AllocationCounters AllocationTracker::total() {
+    return AllocationCounters();
+}
+
+#endif
+
+double AllocationTracker::allocationsPerToken(size_t tokens) {
+    return tokens > 0 ? static_cast<double>(total().allocations) / static_cast<double>(tokens) : 0.0;
+}
+
+void AllocationTracker::printReport(std::ostream& out, size_t tokens) {
+    // Снимок до печати: вывод сам выделяет память
+    AllocationCounters snapshots[PHASE_COUNT];
+    for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+        snapshots[phase] = counters(static_cast<AllocationPhase>(phase));
+    }
+    AllocationCounters sum = total();
+
+    std::ios::fmtflags flags = out.flags();
+    auto row = [&](const char* name, const AllocationCounters& counters) {
+        out << std::left << std::setw(16) << name << std::right
+            << std::setw(12) << counters.allocations << std::setw(14) << counters.bytes
+            << std::setw(14) << counters.peakBytes;
+        if (tokens > 0) {
+            out << std::setw(12) << std::fixed << std::setprecision(2)
+                << static_cast<double>(counters.allocations) / static_cast<double>(tokens);
+        }
+        out << "\n";
+    };
+
+    out << std::left << std::setw(16) << "phase" << std::right << std::setw(12) << "allocs"
+        << std::setw(14) << "bytes" << std::setw(14) << "peak live";
+    if (tokens > 0) out << std::setw(12) << "per token";
+    out << "\n";
+    for (size_t phase = 0; phase < PHASE_COUNT; phase++) {
+        row(phaseName(static_cast<AllocationPhase>(phase)), snapshots[phase]);
+    }
+    row("total", sum);
+    out.flags(flags);
+}
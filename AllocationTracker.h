@@ -0,0 +1,54 @@
+﻿#pragma once
+#include <cstddef>
+#include <ostream>
+
+// Учёт выделений памяти по этапам компиляции. Включается при сборке
+// с JACKC_TRACK_ALLOCATIONS: тогда глобальные operator new/delete
+// заменяются и каждый блок помечается этапом, на котором он выделен.
+// Без макроса AllocationScope ничего не делает.
+
+enum class AllocationPhase { OTHER, TOKENIZER, PARSER, WRITER, COUNT };
+
+struct AllocationCounters {
+    size_t allocations = 0;
+    size_t bytes = 0;
+    long long liveBytes = 0;        // Выделено на этапе и ещё не освобождено
+    long long peakBytes = 0;
+};
+
+class AllocationTracker {
+public:
+    // Собран ли компилятор с учётом выделений
+    static bool available();
+
+    // Обнуляет счётчики; пик отсчитывается от текущего объёма
+    static void reset();
+
+    static AllocationCounters counters(AllocationPhase phase);
+    static AllocationCounters total();
+
+    // Таблица по этапам; tokens > 0 - ещё и выделения на токен
+    static void printReport(std::ostream& out, size_t tokens);
+
+    // Выделения на токен за время после reset()
+    static double allocationsPerToken(size_t tokens);
+};
+
+// Этап для выделений в текущем потоке до конца области видимости
+class AllocationScope {
+public:
+#ifdef JACKC_TRACK_ALLOCATIONS
+    explicit AllocationScope(AllocationPhase phase);
+    ~AllocationScope();
+#else
+    explicit AllocationScope(AllocationPhase) {}
+#endif
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+#ifdef JACKC_TRACK_ALLOCATIONS
+private:
+    AllocationPhase previous;
+#endif
+};
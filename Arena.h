@@ -0,0 +1,99 @@
+﻿#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Линейный (bump) аллокатор. Объекты не уничтожаются по одному:
+// reset() освобождает всё сразу и оставляет блоки для следующего файла.
+class Arena {
+public:
+    explicit Arena(size_t blockSize = 64 * 1024) : blockSize(blockSize) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        size_t padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+        if (current == nullptr || padding + size > remaining) {
+            nextBlock(size + alignment);
+            padding = (alignment - reinterpret_cast<uintptr_t>(current) % alignment) % alignment;
+        }
+        char* result = current + padding;
+        current = result + size;
+        remaining -= padding + size;
+        used += size;
+        return result;
+    }
+
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // Копирует элементы в арену
+    template <typename T>
+    std::span<T> copy(const T* items, size_t count) {
+        static_assert(std::is_trivially_copyable_v<T>, "Arena arrays are copied bytewise");
+        if (count == 0) return {};
+        T* data = static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+        std::memcpy(data, items, sizeof(T) * count);
+        return { data, count };
+    }
+
+    template <typename T>
+    std::span<T> copy(const std::vector<T>& items) {
+        return copy(items.data(), items.size());
+    }
+
+    std::string_view copy(std::string_view text) {
+        if (text.empty()) return {};
+        char* data = static_cast<char*>(allocate(text.size(), 1));
+        std::memcpy(data, text.data(), text.size());
+        return { data, text.size() };
+    }
+
+    // Освобождает всю память за O(1), блоки переиспользуются
+    void reset() {
+        blockIndex = 0;
+        current = blocks.empty() ? nullptr : blocks[0].data.get();
+        remaining = blocks.empty() ? 0 : blocks[0].size;
+        used = 0;
+    }
+
+    size_t bytesUsed() const { return used; }
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    void nextBlock(size_t minSize) {
+        size_t next = (current == nullptr) ? 0 : blockIndex + 1;
+        while (next < blocks.size() && blocks[next].size < minSize) next++;
+        if (next >= blocks.size()) {
+            size_t size = std::max(blockSize, minSize);
+            blocks.push_back({ std::make_unique<char[]>(size), size });
+            next = blocks.size() - 1;
+        }
+        blockIndex = next;
+        current = blocks[next].data.get();
+        remaining = blocks[next].size;
+    }
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t blockIndex = 0;
+    char* current = nullptr;
+    size_t remaining = 0;
+    size_t used = 0;
+};
@@ -0,0 +1,42 @@
+﻿#pragma once
+#include "Expression.h"
+#include "SymbolTable.h"
+#include <span>
+#include <string_view>
+
+// Синтаксическое дерево класса. Все узлы выделяются в арене файла
+// и освобождаются вместе с ней.
+
+enum class StatementKind { LET, IF, WHILE, DO, RETURN };
+
+struct Statement {
+    StatementKind kind;
+    std::string_view name;              // let: переменная
+    Expr* index = nullptr;              // let: индекс массива
+    Expr* value = nullptr;              // let/return: значение, if/while: условие, do: вызов
+    std::span<Statement*> body;         // Ветвь then или тело цикла
+    std::span<Statement*> elseBody;     // Ветвь else
+    size_t line = 0;                    // Строка начала оператора
+};
+
+struct VariableDec {
+    VarKind kind;
+    std::string_view type;
+    std::string_view name;
+};
+
+struct SubroutineDec {
+    Keyword kind;                       // CONSTRUCTOR, FUNCTION или METHOD
+    std::string_view returnType;
+    std::string_view name;
+    std::span<VariableDec> parameters;
+    std::span<VariableDec> locals;
+    std::span<Statement*> body;
+    size_t line = 0;                    // Строка заголовка
+};
+
+struct ClassDec {
+    std::string_view name;
+    std::span<VariableDec> variables;
+    std::span<SubroutineDec*> subroutines;
+};
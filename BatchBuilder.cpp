@@ -0,0 +1,170 @@
+﻿#include "BatchBuilder.h"
+#include "JackCompiler.h"
+#include "OutputWriter.h"
+#include "VMBytecode.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<fs::path> jackFilesIn(const fs::path& directory) {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(directory)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".jack") {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+}
+
+BatchBuilder::BatchBuilder(const CompilerOptions& o, unsigned j)
+    : options(o), jobs(std::max(1u, j)) {
+}
+
+std::vector<fs::path> BatchBuilder::findProjects(const fs::path& root) {
+    std::set<fs::path> projects;
+    if (!jackFilesIn(root).empty()) {
+        projects.insert(root);
+    }
+    for (const auto& entry : fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".jack") {
+            projects.insert(entry.path().parent_path());
+        }
+    }
+    return { projects.begin(), projects.end() };
+}
+
+std::vector<fs::path> BatchBuilder::readManifest(const fs::path& manifest) {
+    std::ifstream in(manifest);
+    if (!in) {
+        throw std::runtime_error("Failed to open manifest: " + manifest.string());
+    }
+
+    std::vector<fs::path> projects;
+    std::string line;
+    while (std::getline(in, line)) {
+        line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        fs::path project = line.substr(first, last - first + 1);
+        projects.push_back(project.is_relative() ? manifest.parent_path() / project : project);
+    }
+    return projects;
+}
+
+BatchBuilder::Statistics BatchBuilder::run(const std::vector<fs::path>& projects, std::ostream& log) {
+    Statistics statistics;
+    statistics.projects = projects.size();
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<size_t> next{ 0 };
+    std::atomic<size_t> files{ 0 };
+    std::atomic<size_t> bytes{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::mutex logMutex;
+    OutputWriter writer;
+
+    auto worker = [&]() {
+        CompilerWorkspace workspace;
+        for (size_t index = next++; index < projects.size(); index = next++) {
+            const fs::path& project = projects[index];
+            std::ostringstream messages;
+            bool ok = true;
+            try {
+                std::vector<fs::path> paths = jackFilesIn(project);
+                std::vector<std::string> texts;
+                std::vector<std::string> names;
+                for (const auto& path : paths) {
+                    std::ifstream in(path, std::ios::binary);
+                    texts.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+                    names.push_back(path.stem().string());
+                    bytes += texts.back().size();
+                }
+                std::vector<JackSource> sources;
+                for (size_t i = 0; i < paths.size(); i++) {
+                    sources.push_back({ names[i], texts[i] });
+                }
+
+                VMOutput output = options.bytecodeOutput ? VMOutput::INSTRUCTIONS : VMOutput::TEXT;
+                CompilationResult result = compileJack(sources, workspace, options, output);
+                for (auto& compiled : result.classes) {
+                    if (options.bytecodeOutput) {
+                        writer.submit(project / (compiled.name + ".vmb"), encodeBytecode(compiled.functions));
+                    }
+                    else {
+                        writer.submit(project / (compiled.name + ".vm"), std::move(compiled.vm));
+                    }
+                }
+                for (const auto& diagnostic : result.diagnostics) {
+                    messages << "Error: " << (project / (diagnostic.source + ".jack")).string();
+                    if (diagnostic.line > 0) messages << ":" << diagnostic.line;
+                    messages << ": " << diagnostic.message << "\n";
+                    ok = false;
+                }
+                files += paths.size();
+            }
+            catch (const std::exception& e) {
+                messages << "Error: " << project.string() << ": " << e.what() << "\n";
+                ok = false;
+            }
+
+            if (!ok) failed++;
+            std::lock_guard<std::mutex> lock(logMutex);
+            log << (ok ? "Compiled project: " : "Failed project: ") << project.string() << "\n"
+                << messages.str();
+        }
+    };
+
+    unsigned threadCount = static_cast<unsigned>(std::min<size_t>(jobs, std::max<size_t>(1, projects.size())));
+    std::vector<std::thread> threads;
+    for (unsigned i = 1; i < threadCount; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<std::string> writeErrors = writer.finish();
+    for (const auto& error : writeErrors) {
+        log << "Error: " << error << "\n";
+    }
+
+    statistics.files = files;
+    statistics.bytes = bytes;
+    statistics.failedProjects = failed;
+    statistics.failedWrites = writeErrors.size();
+    statistics.writer = writer.backendName();
+    statistics.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return statistics;
+}
+
+void BatchBuilder::printStatistics(const Statistics& statistics, std::ostream& out) {
+    double seconds = std::max(statistics.seconds, 1e-9);
+    out << "Batch: " << statistics.projects << " project(s), " << statistics.files << " file(s), "
+        << statistics.bytes / 1024 << " KiB in " << statistics.seconds << " s ("
+        << static_cast<size_t>(statistics.files / seconds) << " files/s, "
+        << statistics.bytes / seconds / (1024 * 1024) << " MiB/s, output via " << statistics.writer << ")";
+    if (statistics.failedProjects > 0) {
+        out << ", " << statistics.failedProjects << " failed";
+    }
+    if (statistics.failedWrites > 0) {
+        out << ", " << statistics.failedWrites << " write error(s)";
+    }
+    out << "\n";
+}
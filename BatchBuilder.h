@@ -0,0 +1,41 @@
+﻿#pragma once
+#include "CompilerOptions.h"
+#include <cstddef>
+#include <filesystem>
+#include <ostream>
+#include <vector>
+
+// Пакетная сборка: каждый каталог с .jack файлами - отдельный проект.
+// Проекты компилируются в одном процессе пулом потоков; потоки и их
+// память (арена) переиспользуются от проекта к проекту. Готовые .vm
+// пишет на диск OutputWriter, потоки компиляции не ждут ввода-вывода.
+class BatchBuilder {
+public:
+    BatchBuilder(const CompilerOptions& options, unsigned jobs);
+
+    struct Statistics {
+        size_t projects = 0;
+        size_t files = 0;
+        size_t bytes = 0;           // Размер исходников
+        size_t failedProjects = 0;
+        size_t failedWrites = 0;
+        const char* writer = "";    // Способ записи: io_uring или threads
+        double seconds = 0;
+    };
+
+    // Собирает проекты; сообщения каждого проекта выводятся одним блоком
+    Statistics run(const std::vector<std::filesystem::path>& projects, std::ostream& log);
+
+    // Каталоги с .jack файлами внутри root (включая сам root)
+    static std::vector<std::filesystem::path> findProjects(const std::filesystem::path& root);
+
+    // Список каталогов проектов, по одному в строке; # - комментарий.
+    // Относительные пути отсчитываются от каталога манифеста.
+    static std::vector<std::filesystem::path> readManifest(const std::filesystem::path& manifest);
+
+    static void printStatistics(const Statistics& statistics, std::ostream& out);
+
+private:
+    CompilerOptions options;
+    unsigned jobs;
+};
@@ -0,0 +1,138 @@
+﻿#include "BuildCache.h"
+#include "Hash.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char* const ENTRY_HEADER = "jackc-cache 2";
+
+std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}
+
+BuildCache::BuildCache(const fs::path& dir, const std::string& configuration)
+    : directory(dir), configurationHash(xxhash64(configuration)) {
+    fs::create_directories(directory);
+}
+
+fs::path BuildCache::entryPath(const std::string& source) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.vmc",
+        static_cast<unsigned long long>(xxhash64(source, configurationHash)));
+    return directory / name;
+}
+
+// Формат записи:
+//   jackc-cache 2
+//   query <purity|type> <подпрограмма> <ответ>     - зависимости от других классов
+//   method <подпрограмма> <тип> <purity> <вид> <число параметров> - объявления файла
+//   vm <размер>                                    - далее текст .vm
+bool BuildCache::restore(const std::string& source, const fs::path& vmPath, SymbolTable& project,
+    SymbolTable::FileSummary* summary) {
+    std::ifstream in(entryPath(source), std::ios::binary);
+    if (!in) {
+        misses++;
+        return false;
+    }
+
+    std::string line;
+    if (!std::getline(in, line) || line != ENTRY_HEADER) {
+        misses++;
+        return false;
+    }
+
+    SymbolTable::FileSummary entry;
+    size_t vmSize = 0;
+    bool hasVm = false;
+    while (!hasVm && std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string tag;
+        fields >> tag;
+        if (tag == "query") {
+            std::string kind, name, value;
+            fields >> kind >> name >> value;
+            std::string query = kind + " " + name;
+            if (project.answerQuery(query) != value) {
+                invalidated++;
+                misses++;
+                return false;
+            }
+            entry.queries.emplace(std::move(query), std::move(value));
+        }
+        else if (tag == "method") {
+            SymbolTable::MethodInfo method;
+            int purity = 0;
+            int kind = 0;
+            fields >> method.name >> method.returnType >> purity >> kind >> method.arity;
+            method.purity = static_cast<Purity>(purity);
+            method.kind = static_cast<Keyword>(kind);
+            entry.methods.push_back(std::move(method));
+        }
+        else if (tag == "vm") {
+            fields >> vmSize;
+            hasVm = true;
+        }
+    }
+
+    std::string vm(vmSize, '\0');
+    if (!hasVm || !in.read(vm.data(), static_cast<std::streamsize>(vmSize))) {
+        misses++;
+        return false;
+    }
+
+    std::ofstream out(vmPath, std::ios::binary);
+    out.write(vm.data(), static_cast<std::streamsize>(vm.size()));
+    if (!out) {
+        misses++;
+        return false;
+    }
+
+    project.importMethods(entry.methods);
+    if (summary != nullptr) {
+        *summary = std::move(entry);
+    }
+    hits++;
+    return true;
+}
+
+void BuildCache::store(const std::string& source, const fs::path& vmPath,
+    const SymbolTable::FileSummary& summary) {
+    std::string vm = readFile(vmPath);
+    fs::path path = entryPath(source);
+    fs::path temporary = path;
+    temporary += ".tmp";
+
+    {
+        std::ofstream out(temporary, std::ios::binary);
+        out << ENTRY_HEADER << "\n";
+        for (const auto& [query, value] : summary.queries) {
+            out << "query " << query << " " << value << "\n";
+        }
+        for (const auto& method : summary.methods) {
+            out << "method " << method.name << " " << method.returnType << " "
+                << static_cast<int>(method.purity) << " " << static_cast<int>(method.kind) << " "
+                << method.arity << "\n";
+        }
+        out << "vm " << vm.size() << "\n" << vm;
+        if (!out) return;
+    }
+    // Запись целиком или никак: параллельная сборка не увидит половину файла
+    std::error_code error;
+    fs::rename(temporary, path, error);
+}
+
+void BuildCache::printStatistics(std::ostream& out) const {
+    out << "Cache: " << hits << " hit(s), " << misses << " miss(es)";
+    if (invalidated > 0) {
+        out << " (" << invalidated << " invalidated by changed declarations)";
+    }
+    out << "\n";
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "SymbolTable.h"
+#include <cstdint>
+#include <filesystem>
+#include <ostream>
+#include <string>
+
+// Кеш результатов компиляции: .vm файл по хешу исходника, версии
+// компилятора и настроек. Запись хранит ответы таблицы проекта,
+// использованные при компиляции, и действительна, только пока они не изменились.
+class BuildCache {
+public:
+    BuildCache(const std::filesystem::path& directory, const std::string& configuration);
+
+    // Восстанавливает vmPath из кеша. При успехе подпрограммы файла
+    // добавляются в таблицу проекта, как после обычной компиляции,
+    // а объявления и запросы записи - в summary.
+    bool restore(const std::string& source, const std::filesystem::path& vmPath, SymbolTable& project,
+        SymbolTable::FileSummary* summary = nullptr);
+
+    // Сохраняет результат компиляции файла
+    void store(const std::string& source, const std::filesystem::path& vmPath,
+        const SymbolTable::FileSummary& summary);
+
+    void printStatistics(std::ostream& out) const;
+
+private:
+    std::filesystem::path entryPath(const std::string& source) const;
+
+    std::filesystem::path directory;
+    uint64_t configurationHash;
+    int hits = 0;
+    int misses = 0;
+    int invalidated = 0;            // Запись есть, но изменились объявления других классов
+};
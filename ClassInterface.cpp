@@ -0,0 +1,225 @@
+﻿#include "ClassInterface.h"
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char MAGIC[4] = { 'J', 'K', 'I', '1' };
+constexpr uint32_t FORMAT_VERSION = 1;
+constexpr size_t HEADER_SIZE = 48;
+constexpr size_t SUBROUTINE_SIZE = 12;
+constexpr size_t QUERY_SIZE = 8;
+
+uint64_t readLE(const unsigned char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+void writeLE(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+    }
+}
+
+// Таблица строк без повторов
+class StringTable {
+public:
+    uint32_t add(std::string_view text) {
+        auto it = offsets.find(std::string(text));
+        if (it != offsets.end()) return it->second;
+        uint32_t offset = static_cast<uint32_t>(data.size());
+        data.append(text);
+        data.push_back('\0');
+        offsets.emplace(std::string(text), offset);
+        return offset;
+    }
+
+    const std::string& bytes() const { return data; }
+
+private:
+    std::string data;
+    std::unordered_map<std::string, uint32_t> offsets;
+};
+
+}
+
+void ClassInterface::write(const fs::path& path, uint64_t sourceHash,
+    uint64_t configurationHash, std::string_view className,
+    int fieldCount, int staticCount, const SymbolTable::FileSummary& summary) {
+    StringTable strings;
+    uint32_t nameOffset = strings.add(className);
+
+    const auto& methods = summary.methods;
+    std::string records;
+    for (const auto& method : methods) {
+        writeLE(records, strings.add(method.name), 4);
+        writeLE(records, strings.add(method.returnType), 4);
+        writeLE(records, static_cast<uint8_t>(method.kind), 1);
+        writeLE(records, static_cast<uint8_t>(method.purity), 1);
+        writeLE(records, static_cast<uint16_t>(method.arity), 2);
+    }
+
+    const auto& queries = summary.queries;
+    for (const auto& [query, answer] : queries) {
+        writeLE(records, strings.add(query), 4);
+        writeLE(records, strings.add(answer), 4);
+    }
+
+    std::string out(MAGIC, sizeof(MAGIC));
+    writeLE(out, FORMAT_VERSION, 4);
+    writeLE(out, sourceHash, 8);
+    writeLE(out, configurationHash, 8);
+    writeLE(out, nameOffset, 4);
+    writeLE(out, static_cast<uint16_t>(fieldCount), 2);
+    writeLE(out, static_cast<uint16_t>(staticCount), 2);
+    writeLE(out, methods.size(), 4);
+    writeLE(out, queries.size(), 4);
+    writeLE(out, strings.bytes().size(), 4);
+    writeLE(out, 0, 4);
+    out += records;
+    out += strings.bytes();
+
+    // Неизменённый интерфейс не трогаем: время изменения файла остаётся прежним
+    {
+        MappedFile existing(path);
+        if (existing.size() == out.size() && std::memcmp(existing.data(), out.data(), out.size()) == 0) {
+            return;
+        }
+    }
+
+    fs::path temporary = path;
+    temporary += ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        file.write(out.data(), static_cast<std::streamsize>(out.size()));
+        if (!file) return;
+    }
+    std::error_code error;
+    fs::rename(temporary, path, error);
+}
+
+ClassInterface::ClassInterface(const fs::path& path) : file(path) {
+    const unsigned char* p = file.data();
+    if (file.size() < HEADER_SIZE || std::memcmp(p, MAGIC, sizeof(MAGIC)) != 0 ||
+        readLE(p + 4, 4) != FORMAT_VERSION) {
+        return;
+    }
+    uint64_t stringsSize = readLE(p + 40, 4);
+    uint64_t expected = HEADER_SIZE + subroutineCount() * SUBROUTINE_SIZE +
+        queryCount() * QUERY_SIZE + stringsSize;
+    if (expected != file.size() || stringsSize == 0 || p[file.size() - 1] != '\0') {
+        return;
+    }
+
+    // Все ссылки на строки должны попадать в таблицу строк
+    const unsigned char* records = p + HEADER_SIZE;
+    size_t references = subroutineCount() * SUBROUTINE_SIZE + queryCount() * QUERY_SIZE;
+    if (readLE(p + 24, 4) >= stringsSize) return;
+    for (size_t i = 0; i < subroutineCount(); i++) {
+        const unsigned char* record = records + i * SUBROUTINE_SIZE;
+        if (readLE(record, 4) >= stringsSize || readLE(record + 4, 4) >= stringsSize) return;
+    }
+    for (size_t offset = subroutineCount() * SUBROUTINE_SIZE; offset < references; offset += 4) {
+        if (readLE(records + offset, 4) >= stringsSize) return;
+    }
+    valid = true;
+}
+
+std::string_view ClassInterface::string(uint32_t offset) const {
+    size_t start = HEADER_SIZE + subroutineCount() * SUBROUTINE_SIZE + queryCount() * QUERY_SIZE;
+    return reinterpret_cast<const char*>(file.data() + start + offset);
+}
+
+uint64_t ClassInterface::sourceHash() const {
+    return readLE(file.data() + 8, 8);
+}
+
+uint64_t ClassInterface::configurationHash() const {
+    return readLE(file.data() + 16, 8);
+}
+
+std::string_view ClassInterface::className() const {
+    return string(static_cast<uint32_t>(readLE(file.data() + 24, 4)));
+}
+
+int ClassInterface::fieldCount() const {
+    return static_cast<int>(readLE(file.data() + 28, 2));
+}
+
+int ClassInterface::staticCount() const {
+    return static_cast<int>(readLE(file.data() + 30, 2));
+}
+
+size_t ClassInterface::subroutineCount() const {
+    return static_cast<size_t>(readLE(file.data() + 32, 4));
+}
+
+ClassInterface::Subroutine ClassInterface::subroutine(size_t index) const {
+    const unsigned char* record = file.data() + HEADER_SIZE + index * SUBROUTINE_SIZE;
+    return {
+        string(static_cast<uint32_t>(readLE(record, 4))),
+        string(static_cast<uint32_t>(readLE(record + 4, 4))),
+        static_cast<Keyword>(record[8]),
+        static_cast<Purity>(record[9]),
+        static_cast<int>(readLE(record + 10, 2))
+    };
+}
+
+size_t ClassInterface::queryCount() const {
+    return static_cast<size_t>(readLE(file.data() + 36, 4));
+}
+
+std::pair<std::string_view, std::string_view> ClassInterface::query(size_t index) const {
+    const unsigned char* record = file.data() + HEADER_SIZE +
+        subroutineCount() * SUBROUTINE_SIZE + index * QUERY_SIZE;
+    return { string(static_cast<uint32_t>(readLE(record, 4))),
+        string(static_cast<uint32_t>(readLE(record + 4, 4))) };
+}
+
+bool ClassInterface::queriesHold(const SymbolTable& project) const {
+    for (size_t i = 0; i < queryCount(); i++) {
+        auto [question, answer] = query(i);
+        if (project.answerQuery(question) != answer) return false;
+    }
+    return true;
+}
+
+void ClassInterface::exportTo(SymbolTable& project) const {
+    for (size_t i = 0; i < subroutineCount(); i++) {
+        Subroutine method = subroutine(i);
+        project.defineMethod(method.name, method.returnType, method.kind, method.arity);
+        project.setMethodPurity(method.name, method.purity);
+    }
+}
+
+SymbolTable::FileSummary ClassInterface::summary() const {
+    SymbolTable::FileSummary result;
+    for (size_t i = 0; i < subroutineCount(); i++) {
+        Subroutine method = subroutine(i);
+        result.methods.push_back({ std::string(method.name), std::string(method.returnType),
+            method.purity, method.kind, method.arity });
+    }
+    for (size_t i = 0; i < queryCount(); i++) {
+        auto [question, answer] = query(i);
+        result.queries.emplace(question, answer);
+    }
+    return result;
+}
+
+std::vector<bool> matchingInterfaces(const std::vector<fs::path>& paths,
+    const std::vector<uint64_t>& sourceHashes, uint64_t configurationHash) {
+    std::vector<bool> matching(paths.size(), false);
+    for (size_t i = 0; i < paths.size(); i++) {
+        ClassInterface classInterface(paths[i]);
+        matching[i] = classInterface.isValid() &&
+            classInterface.sourceHash() == sourceHashes[i] &&
+            classInterface.configurationHash() == configurationHash;
+    }
+    return matching;
+}
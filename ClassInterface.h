@@ -0,0 +1,75 @@
+﻿#pragma once
+#include "MappedFile.h"
+#include "SymbolTable.h"
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Двоичный интерфейс класса (.vmi): подпрограммы с видом, числом
+// параметров, типом результата и чистотой, число полей и статических
+// переменных, а также ответы таблицы проекта, на которых основан .vm.
+// Файл читается через отображение в память, без разбора исходника.
+//
+// Формат (little-endian, смещения строк - от начала таблицы строк):
+//   заголовок     "JKI1", u32 версия, u64 хеш исходника, u64 хеш настроек,
+//                 u32 имя класса, u16 поля, u16 статические,
+//                 u32 подпрограммы, u32 запросы, u32 размер строк, u32 0
+//   подпрограммы  u32 имя, u32 тип, u8 вид, u8 чистота, u16 параметры
+//   запросы       u32 запрос, u32 ответ
+//   строки        завершаются нулём
+class ClassInterface {
+public:
+    struct Subroutine {
+        std::string_view name;
+        std::string_view returnType;
+        Keyword kind;
+        Purity purity;
+        int arity;
+    };
+
+    // Сохраняет интерфейс скомпилированного класса. Файл не переписывается,
+    // если содержимое не изменилось.
+    static void write(const std::filesystem::path& path, uint64_t sourceHash,
+        uint64_t configurationHash, std::string_view className,
+        int fieldCount, int staticCount, const SymbolTable::FileSummary& summary);
+
+    explicit ClassInterface(const std::filesystem::path& path);
+
+    // Файл существует и имеет правильный формат
+    bool isValid() const { return valid; }
+
+    uint64_t sourceHash() const;
+    uint64_t configurationHash() const;
+    std::string_view className() const;
+    int fieldCount() const;
+    int staticCount() const;
+
+    size_t subroutineCount() const;
+    Subroutine subroutine(size_t index) const;
+
+    size_t queryCount() const;
+    std::pair<std::string_view, std::string_view> query(size_t index) const;
+
+    // Все запросы к таблице проекта дают прежние ответы
+    bool queriesHold(const SymbolTable& project) const;
+
+    // Добавляет подпрограммы класса в таблицу проекта
+    void exportTo(SymbolTable& project) const;
+
+    // Объявления и запросы в том же виде, что даёт таблица после компиляции
+    SymbolTable::FileSummary summary() const;
+
+private:
+    std::string_view string(uint32_t offset) const;
+
+    MappedFile file;
+    bool valid = false;
+};
+
+// Какие интерфейсы действительны и совпадают по хешам исходника и настроек.
+// Запросы такого интерфейса сборка проверяет позже, по объявлениям
+// классов, которые компилируются раньше него.
+std::vector<bool> matchingInterfaces(const std::vector<std::filesystem::path>& paths,
+    const std::vector<uint64_t>& sourceHashes, uint64_t configurationHash);
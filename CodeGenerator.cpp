@@ -0,0 +1,816 @@
+﻿#include "CodeGenerator.h"
+#include "Optimizer.h"
+#include "Superinstructions.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+CodeGenerator::CodeGenerator(VMWriter& v,
+    SymbolTable& s,
+    const std::string& cName,
+    const CompilerOptions& o)
+    : vmWriter(v), symbolTable(s), className(cName), options(o), passes(o) {
+    passes.add(OptimizationPass::PROFILE_LAYOUT, [this](VMFunction& function) {
+        for (const auto& labels : hotElse) {
+            swapBranches(function, labels);
+        }
+    });
+    passes.add(OptimizationPass::LICM, [this](VMFunction& function) {
+        hoistLoopInvariants(function, symbolTable);
+    });
+    passes.add(OptimizationPass::CFG, optimizeControlFlow);
+    passes.add(OptimizationPass::SUPERINSTRUCTIONS, fuseSuperinstructions);
+}
+
+void CodeGenerator::setClassName(std::string_view name) {
+    className = name;
+}
+
+void CodeGenerator::setSourceLine(size_t line) {
+    sourceLine = line;
+    vmWriter.setSourceLine(line);
+}
+
+void CodeGenerator::generateClass(const ClassDec& classDec) {
+    setClassName(classDec.name);
+    defineVariables(classDec.variables);
+    for (const SubroutineDec* subroutine : classDec.subroutines) {
+        generateSubroutine(*subroutine);
+    }
+}
+
+void CodeGenerator::generateSubroutine(const SubroutineDec& subroutine) {
+    beginSubroutine(subroutine);
+    defineVariables(subroutine.locals);
+    beginBody();
+    generateStatements(subroutine.body);
+    endSubroutine();
+}
+
+void CodeGenerator::generateStatements(std::span<Statement* const> statements) {
+    std::vector<Frame> frames;
+    frames.push_back({ nullptr, statements });
+    runFrames(frames);
+}
+
+void CodeGenerator::generateStatement(const Statement& statement) {
+    setSourceLine(statement.line);
+    switch (statement.kind) {
+    case StatementKind::LET:
+        generateLet(statement);
+        break;
+    case StatementKind::IF:
+    case StatementKind::WHILE: {
+        std::vector<Frame> frames;
+        openFrame(frames, statement);
+        runFrames(frames);
+        break;
+    }
+    case StatementKind::DO:
+        generateDo(statement);
+        break;
+    case StatementKind::RETURN:
+        generateReturn(statement);
+        break;
+    }
+}
+
+// Обход вложенных блоков на явном стеке
+void CodeGenerator::runFrames(std::vector<Frame>& frames) {
+    while (!frames.empty()) {
+        Frame& frame = frames.back();
+        if (frame.next < frame.statements.size()) {
+            const Statement& statement = *frame.statements[frame.next++];
+            if (statement.kind == StatementKind::IF || statement.kind == StatementKind::WHILE) {
+                openFrame(frames, statement);
+            }
+            else {
+                generateStatement(statement);
+            }
+            continue;
+        }
+
+        const Statement* owner = frame.owner;
+        if (owner == nullptr) {
+            frames.pop_back();
+        }
+        else if (owner->kind == StatementKind::WHILE) {
+            endWhile(frame.whileLabels);
+            frames.pop_back();
+        }
+        else if (!frame.inElse) {
+            beginElse(frame.ifLabels);
+            frame.statements = owner->elseBody;
+            frame.next = 0;
+            frame.inElse = true;
+        }
+        else {
+            endIf(frame.ifLabels);
+            frames.pop_back();
+        }
+    }
+}
+
+void CodeGenerator::openFrame(std::vector<Frame>& frames, const Statement& statement) {
+    setSourceLine(statement.line);
+    Frame frame{ &statement, statement.body };
+    if (statement.kind == StatementKind::IF) {
+        frame.ifLabels = beginIf(statement.value);
+    }
+    else {
+        frame.whileLabels = beginWhile(statement.value);
+    }
+    frames.push_back(std::move(frame));
+}
+
+void CodeGenerator::defineVariables(std::span<const VariableDec> variables) {
+    for (const auto& variable : variables) {
+        symbolTable.define(variable.name, variable.type, variable.kind);
+    }
+}
+
+// Начало подпрограммы: таблица символов и параметры (this - нулевой аргумент метода)
+void CodeGenerator::beginSubroutine(const SubroutineDec& signature) {
+    symbolTable.startSubroutine();
+    clearAvailableExpressions();
+    extraLocals = 0;
+    statementCount = 0;
+    returnPurity = Purity::IMPURE;
+    printedLiteral = nullptr;
+    blockCounter = 0;
+    blockCounts.clear();
+    hotElse.clear();
+    // Метки видны только внутри функции: код подпрограммы не зависит от соседних
+    labelCounter = 0;
+
+    subroutineKind = signature.kind;
+    setSourceLine(signature.line);
+    currentSubroutine = className + "." + std::string(signature.name);
+    symbolTable.defineMethod(currentSubroutine, signature.returnType,
+        signature.kind, static_cast<int>(signature.parameters.size()));
+    subroutineArity = static_cast<int>(signature.parameters.size());
+
+    if (subroutineKind == Keyword::METHOD) {
+        symbolTable.define("this", className, VarKind::ARG);
+    }
+    defineVariables(signature.parameters);
+}
+
+// Заголовок функции и пролог; локальные переменные уже определены
+void CodeGenerator::beginBody() {
+    vmWriter.writeFunction(currentSubroutine, symbolTable.varCount(VarKind::VAR));
+
+    switch (subroutineKind) {
+    case Keyword::CONSTRUCTOR: {
+        int fieldCount = symbolTable.varCount(VarKind::FIELD);
+        vmWriter.writePush("constant", fieldCount);
+        vmWriter.writeCall("Memory.alloc", 1);
+        vmWriter.writePop("pointer", 0);
+        break;
+    }
+    case Keyword::METHOD: {
+        vmWriter.writePush("argument", 0);
+        vmWriter.writePop("pointer", 0);
+        break;
+    }
+    case Keyword::FUNCTION: {
+        break;
+    }
+    default:
+        throw std::runtime_error("Invalid subroutine type");
+    }
+    enterBlock(currentSubroutine);
+}
+
+// Завершает подпрограмму: материализует точки сохранения CSE, оптимизирует и записывает буфер
+void CodeGenerator::endSubroutine() {
+    // Подпрограмма вида "return <выражение без побочных эффектов>;"
+    if (statementCount == 1 && returnPurity != Purity::IMPURE &&
+        subroutineKind != Keyword::CONSTRUCTOR) {
+        symbolTable.setMethodPurity(currentSubroutine, returnPurity);
+    }
+
+    VMFunction& function = vmWriter.currentFunction();
+    function.nLocals += extraLocals;
+
+    if (extraLocals > 0) {
+        std::vector<VMInstruction> body;
+        body.reserve(function.body.size() + 2 * extraLocals);
+        for (auto& instruction : function.body) {
+            if (instruction.op != VMOp::NOP) {
+                body.push_back(std::move(instruction));
+            }
+            else if (instruction.index >= 0) {
+                body.push_back({ VMOp::POP, Segment::LOCAL, instruction.index, {}, instruction.line });
+                body.push_back({ VMOp::PUSH, Segment::LOCAL, instruction.index, {}, instruction.line });
+            }
+        }
+        function.body.swap(body);
+    }
+
+    passes.run(function, vmWriter.fileStatistics());
+    rememberInlineCandidate(function);
+
+    vmWriter.flushFunction();
+    clearAvailableExpressions();
+}
+
+// Чтение элемента массива в значении меняет pointer 1
+static bool readsArray(const Expr* expr) {
+    std::vector<const Expr*> pending = { expr };
+    while (!pending.empty()) {
+        const Expr* node = pending.back();
+        pending.pop_back();
+        if (node->kind == ExprKind::ARRAY_ACCESS) return true;
+        pending.insert(pending.end(), node->operands.begin(), node->operands.end());
+    }
+    return false;
+}
+
+void CodeGenerator::generateLet(const Statement& statement) {
+    statementCount++;
+
+    VarKind kind = symbolTable.kindOf(statement.name);
+    if (statement.index != nullptr) {
+        vmWriter.writePush(kindToSegment(kind), symbolTable.indexOf(statement.name));
+        emitExpression(statement.index);
+        vmWriter.writeArithmetic("add");
+
+        if (readsArray(statement.value) || options.superinstructions) {
+            // Адрес сохраняется в pointer 1 только после вычисления значения
+            // (в расширенном диалекте эта форма становится одной командой store)
+            emitExpression(statement.value);
+            vmWriter.writePop("temp", 0);
+            vmWriter.writePop("pointer", 1);
+            vmWriter.writePush("temp", 0);
+        }
+        else {
+            vmWriter.writePop("pointer", 1);
+            emitExpression(statement.value);
+        }
+        vmWriter.writePop("that", 0);
+        invalidateMemory();
+    }
+    else {
+        emitExpression(statement.value);
+        vmWriter.writePop(kindToSegment(kind), symbolTable.indexOf(statement.name));
+        invalidateVariable(statement.name);
+        if (kind == VarKind::FIELD || kind == VarKind::STATIC) {
+            invalidateMemory();
+        }
+    }
+}
+
+// Вызов как выражение; результат всегда снимается со стека
+void CodeGenerator::generateDo(const Statement& statement) {
+    statementCount++;
+    emitExpression(statement.value, false);
+    vmWriter.writePop("temp", 0);
+}
+
+void CodeGenerator::generateReturn(const Statement& statement) {
+    statementCount++;
+
+    if (statement.value != nullptr) {
+        ExprSummary summary = emitExpression(statement.value);
+        if (statementCount == 1 && !summary.sideEffects) {
+            returnPurity = withFailure(summary.readsMemory ? Purity::READS_MEMORY : Purity::PURE, summary.mayFail);
+        }
+    }
+    else {
+        vmWriter.writePush("constant", 0);
+    }
+    vmWriter.writeReturn();
+}
+
+CodeGenerator::IfLabels CodeGenerator::beginIf(const Expr* condition) {
+    statementCount++;
+    IfLabels labels{ generateLabel("IF_TRUE"), generateLabel("IF_FALSE"), generateLabel("END_IF") };
+
+    emitExpression(condition);
+    vmWriter.writeIf(labels.trueLabel);
+    vmWriter.writeGoto(labels.falseLabel);
+    vmWriter.writeLabel(labels.trueLabel);
+    clearAvailableExpressions();
+
+    labels.block = blockCounter;
+    blockCounter += 2;
+    enterBlock(blockSite(labels.block));
+    if (options.profile != nullptr &&
+        options.profile->count(blockSite(labels.block + 1)) > options.profile->count(blockSite(labels.block))) {
+        hotElse.push_back(labels);
+    }
+    return labels;
+}
+
+void CodeGenerator::beginElse(const IfLabels& labels) {
+    vmWriter.writeGoto(labels.endLabel);
+    vmWriter.writeLabel(labels.falseLabel);
+    clearAvailableExpressions();
+    leaveBlock();
+    enterBlock(blockSite(labels.block + 1));
+}
+
+void CodeGenerator::endIf(const IfLabels& labels) {
+    vmWriter.writeLabel(labels.endLabel);
+    clearAvailableExpressions();
+    leaveBlock();
+}
+
+CodeGenerator::WhileLabels CodeGenerator::beginWhile(const Expr* condition) {
+    statementCount++;
+    WhileLabels labels{ generateLabel("WHILE_START"), generateLabel("WHILE_END"), sourceLine };
+
+    vmWriter.writeLabel(labels.startLabel);
+    clearAvailableExpressions();
+    emitExpression(condition);
+    vmWriter.writeArithmetic("not");
+    vmWriter.writeIf(labels.endLabel);
+    enterBlock(blockSite(blockCounter++));
+    return labels;
+}
+
+void CodeGenerator::endWhile(const WhileLabels& labels) {
+    setSourceLine(labels.line);
+    vmWriter.writeGoto(labels.startLabel);
+    vmWriter.writeLabel(labels.endLabel);
+    clearAvailableExpressions();
+    leaveBlock();
+}
+
+void CodeGenerator::generateExpression(const Expr* expr) {
+    emitExpression(expr);
+}
+
+// Генерирует код выражения, переиспользуя уже вычисленные в этом базовом блоке.
+// Дерево обходится в обратном порядке на явном стеке.
+CodeGenerator::ExprSummary CodeGenerator::emitExpression(const Expr* root, bool cacheRoot) {
+    std::vector<EmitFrame> frames;
+    ExprSummary summary;
+
+    if (cacheRoot && reuseExpression(root, summary)) {
+        return summary;
+    }
+    frames.push_back({ root, 0, beginTerm(root) });
+
+    while (true) {
+        EmitFrame& frame = frames.back();
+        if (frame.next < frame.expr->operands.size()) {
+            const Expr* operand = frame.expr->operands[frame.next++];
+            if (reuseExpression(operand, summary)) {
+                frame.summary.merge(summary);
+            }
+            else {
+                ExprSummary start = beginTerm(operand);
+                frames.push_back({ operand, 0, start });
+            }
+            continue;
+        }
+
+        const Expr* expr = frame.expr;
+        summary = frame.summary;
+        finishTerm(expr, summary);
+        frames.pop_back();
+
+        if (frames.empty()) {
+            if (cacheRoot) recordExpression(expr, summary);
+            return summary;
+        }
+        recordExpression(expr, summary);
+        frames.back().summary.merge(summary);
+    }
+}
+
+// Выражение уже вычислено в этом базовом блоке: push сохранённого значения
+bool CodeGenerator::reuseExpression(const Expr* expr, ExprSummary& summary) {
+    if (!options.eliminateCommonSubexpressions) return false;
+
+    for (auto& available : availableExpressions) {
+        if (sameExpr(available.expr, expr)) {
+            if (available.local < 0) {
+                available.local = symbolTable.varCount(VarKind::VAR) + extraLocals++;
+                vmWriter.currentFunction().body[available.savePoint].index = available.local;
+            }
+            vmWriter.writePush("local", available.local);
+            summary = available.summary;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CodeGenerator::recordExpression(const Expr* expr, const ExprSummary& summary) {
+    // Дешёвые выражения проще пересчитать, чем хранить в локальной переменной
+    if (options.eliminateCommonSubexpressions &&
+        !summary.sideEffects && (summary.hasCall || summary.cost > 3)) {
+        AvailableExpression available{ expr, vmWriter.writeSavePoint(), -1, summary, {} };
+        collectVariables(expr, available.variables);
+        availableExpressions.push_back(std::move(available));
+    }
+}
+
+// Код узла до его операндов: константы, переменные, объект вызова
+CodeGenerator::ExprSummary CodeGenerator::beginTerm(const Expr* expr) {
+    ExprSummary summary;
+
+    switch (expr->kind) {
+        case ExprKind::INT_CONST:
+            vmWriter.writePush("constant", expr->value);
+            summary.cost = 1;
+            break;
+
+        case ExprKind::STRING_CONST: {
+            std::string_view str = expr->name;
+            // Адрес узла может достаться другому литералу после arena.reset()
+            bool pooled = expr == printedLiteral && inHotBlock();
+            printedLiteral = nullptr;
+            if (pooled) {
+                emitPooledString(str);
+            }
+            else {
+                emitString(str);
+            }
+            // Каждое вычисление создаёт новый объект, переиспользовать нельзя
+            summary.cost = 2 + 2 * static_cast<int>(str.length());
+            summary.hasCall = true;
+            summary.sideEffects = true;
+            break;
+        }
+
+        case ExprKind::KEYWORD_CONST:
+            switch (expr->keyword) {
+                case Keyword::TRUE:
+                    vmWriter.writePush("constant", 1);
+                    vmWriter.writeArithmetic("neg");
+                    summary.cost = 2;
+                    break;
+                case Keyword::THIS:
+                    vmWriter.writePush("pointer", 0);
+                    summary.cost = 1;
+                    break;
+                default:
+                    vmWriter.writePush("constant", 0);
+                    summary.cost = 1;
+            }
+            break;
+
+        case ExprKind::VARIABLE: {
+            VarKind kind = symbolTable.kindOf(expr->name);
+            vmWriter.writePush(kindToSegment(kind), symbolTable.indexOf(expr->name));
+            summary.cost = 1;
+            summary.readsMemory = (kind == VarKind::FIELD || kind == VarKind::STATIC);
+            break;
+        }
+
+        case ExprKind::SUBROUTINE_CALL:
+            if (expr->qualifier == "Output" && expr->name == "printString" &&
+                expr->operands.size() == 1 && expr->operands[0]->kind == ExprKind::STRING_CONST) {
+                printedLiteral = expr->operands[0];
+            }
+            if (!expr->qualifier.empty()) {
+                VarKind kind = symbolTable.kindOf(expr->qualifier);
+                if (kind != VarKind::NONE) {
+                    // Вызов метода объекта
+                    vmWriter.writePush(kindToSegment(kind), symbolTable.indexOf(expr->qualifier));
+                    summary.readsMemory = (kind == VarKind::FIELD || kind == VarKind::STATIC);
+                    summary.cost++;
+                }
+            }
+            else {
+                // Вызов метода текущего объекта
+                vmWriter.writePush("pointer", 0);
+                summary.cost++;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return summary;
+}
+
+// Код узла после операндов: операция, чтение элемента массива, вызов
+void CodeGenerator::finishTerm(const Expr* expr, ExprSummary& summary) {
+    switch (expr->kind) {
+        case ExprKind::ARRAY_ACCESS: {
+            VarKind kind = symbolTable.kindOf(expr->name);
+            vmWriter.writePush(kindToSegment(kind), symbolTable.indexOf(expr->name));
+            vmWriter.writeArithmetic("add");
+            vmWriter.writePop("pointer", 1);
+            vmWriter.writePush("that", 0);
+            summary.cost += 4;
+            summary.readsMemory = true;
+            break;
+        }
+
+        case ExprKind::SUBROUTINE_CALL: {
+            std::string fullName;
+            int nArgs = static_cast<int>(expr->operands.size());
+
+            if (!expr->qualifier.empty()) {
+                if (symbolTable.kindOf(expr->qualifier) != VarKind::NONE) {
+                    fullName = symbolTable.typeOf(expr->qualifier) + "." + std::string(expr->name);
+                    nArgs++;
+                }
+                else {
+                    fullName = std::string(expr->qualifier) + "." + std::string(expr->name);
+                }
+            }
+            else {
+                fullName = className + "." + std::string(expr->name);
+                nArgs++;
+            }
+
+            if (!inlineCall(fullName, nArgs)) {
+                vmWriter.writeCall(fullName, nArgs);
+            }
+            summary.cost++;
+            summary.hasCall = true;
+
+            Purity purity = symbolTable.getMethodPurity(fullName);
+            summary.mayFail = summary.mayFail || mayFail(purity);
+            switch (withoutFailure(purity)) {
+                case Purity::IMPURE:
+                    summary.sideEffects = true;
+                    invalidateMemory();
+                    break;
+                case Purity::READS_MEMORY:
+                    summary.readsMemory = true;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+
+        case ExprKind::UNARY_OP:
+            if (expr->op == "-") vmWriter.writeArithmetic("neg");
+            else if (expr->op == "~") vmWriter.writeArithmetic("not");
+            summary.cost++;
+            break;
+
+        case ExprKind::BINARY_OP:
+            emitOperator(expr->op);
+            summary.cost++;
+            if (expr->op == "*" || expr->op == "/") {
+                summary.hasCall = true;
+            }
+            summary.mayFail = summary.mayFail || expr->op == "/";
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Преобразует операторы Jack в VM-команды
+void CodeGenerator::emitOperator(std::string_view op) {
+    if (op == "<=") {
+        vmWriter.writeArithmetic("gt");
+        vmWriter.writeArithmetic("not");
+        return;
+    }
+    if (op == ">=") {
+        vmWriter.writeArithmetic("lt");
+        vmWriter.writeArithmetic("not");
+        return;
+    }
+    if (op == "*") {
+        vmWriter.writeCall("Math.multiply", 2);
+        return;
+    }
+    if (op == "/") {
+        vmWriter.writeCall("Math.divide", 2);
+        return;
+    }
+
+    static const std::unordered_map<std::string_view, std::string> opMap = {
+        {"+", "add"},
+        {"-", "sub"},
+        {"&", "and"},
+        {"|", "or"},
+        {"<", "lt"},
+        {">", "gt"},
+        {"=", "eq"},
+        {"~", "not"}
+    };
+
+    auto it = opMap.find(op);
+    if (it == opMap.end()) {
+        throw std::runtime_error("Unknown operator: " + std::string(op));
+    }
+    vmWriter.writeArithmetic(it->second);
+}
+
+// Переменные, от которых зависит значение выражения
+void CodeGenerator::collectVariables(const Expr* expr, std::vector<std::string_view>& variables) const {
+    std::vector<const Expr*> pending = { expr };
+    while (!pending.empty()) {
+        const Expr* node = pending.back();
+        pending.pop_back();
+
+        if (node->kind == ExprKind::VARIABLE || node->kind == ExprKind::ARRAY_ACCESS) {
+            variables.push_back(node->name);
+        }
+        if (node->kind == ExprKind::SUBROUTINE_CALL && !node->qualifier.empty() &&
+            symbolTable.kindOf(node->qualifier) != VarKind::NONE) {
+            variables.push_back(node->qualifier);
+        }
+        pending.insert(pending.end(), node->operands.begin(), node->operands.end());
+    }
+}
+
+// Присваивание переменной делает недействительными выражения с ней
+void CodeGenerator::invalidateVariable(std::string_view name) {
+    std::erase_if(availableExpressions, [&](const AvailableExpression& available) {
+        return std::find(available.variables.begin(), available.variables.end(), name)
+            != available.variables.end();
+    });
+}
+
+// Запись в память или вызов с побочными эффектами
+void CodeGenerator::invalidateMemory() {
+    std::erase_if(availableExpressions, [](const AvailableExpression& available) {
+        return available.summary.readsMemory;
+    });
+}
+
+// Граница базового блока (метка)
+void CodeGenerator::clearAvailableExpressions() {
+    availableExpressions.clear();
+}
+
+// Начало блока: счётчик в инструментированном коде, число исполнений по профилю
+void CodeGenerator::enterBlock(const std::string& site) {
+    if (options.instrument) {
+        vmWriter.writeCounter(site);
+    }
+    if (options.profile != nullptr) {
+        blockCounts.push_back(options.profile->count(site));
+    }
+}
+
+void CodeGenerator::leaveBlock() {
+    if (!blockCounts.empty()) {
+        blockCounts.pop_back();
+    }
+}
+
+std::string CodeGenerator::blockSite(int block) const {
+    return currentSubroutine + "#" + std::to_string(block);
+}
+
+bool CodeGenerator::inHotBlock() const {
+    return options.profile != nullptr && !blockCounts.empty() && options.profile->isHot(blockCounts.back());
+}
+
+// if-goto T; goto F; label T; <then>; goto E; label F; <else>; label E
+//   -> if-goto T; label F; <else>; goto E; label T; <then>; label E
+// Горячая ветка else идёт сразу за условием, без перехода
+void CodeGenerator::swapBranches(VMFunction& function, const IfLabels& labels) const {
+    auto& body = function.body;
+    auto find = [&](const std::string& label) {
+        return std::find_if(body.begin(), body.end(), [&](const VMInstruction& instruction) {
+            return instruction.op == VMOp::LABEL && instruction.name == label;
+        }) - body.begin();
+    };
+    auto size = static_cast<ptrdiff_t>(body.size());
+    ptrdiff_t trueLabel = find(labels.trueLabel);
+    ptrdiff_t falseLabel = find(labels.falseLabel);
+    ptrdiff_t endLabel = find(labels.endLabel);
+    if (trueLabel == 0 || trueLabel >= falseLabel || falseLabel >= endLabel || endLabel >= size) return;
+    const VMInstruction& gotoFalse = body[trueLabel - 1];
+    const VMInstruction& gotoEnd = body[falseLabel - 1];
+    if (gotoFalse.op != VMOp::GOTO || gotoFalse.name != labels.falseLabel ||
+        gotoEnd.op != VMOp::GOTO || gotoEnd.name != labels.endLabel) {
+        return;
+    }
+
+    std::vector<VMInstruction> swapped;
+    swapped.reserve(body.size());
+    swapped.insert(swapped.end(), body.begin(), body.begin() + trueLabel - 1);
+    swapped.insert(swapped.end(), body.begin() + falseLabel, body.begin() + endLabel);
+    swapped.push_back(gotoEnd);
+    swapped.insert(swapped.end(), body.begin() + trueLabel, body.begin() + falseLabel - 1);
+    swapped.insert(swapped.end(), body.begin() + endLabel, body.end());
+    body.swap(swapped);
+}
+
+// Встраивать можно короткие функции без переходов, которые не меняют
+// pointer (вызов восстановил бы this и that вызывающего)
+void CodeGenerator::rememberInlineCandidate(const VMFunction& optimized) {
+    const size_t INLINE_LIMIT = 32;
+    if (options.profile == nullptr) return;
+    // Встраивается обычный код: тело вызывающей ещё пройдёт все проходы
+    VMFunction function = optimized;
+    lowerSuperinstructions(function);
+    if (subroutineKind != Keyword::FUNCTION ||
+        function.body.empty() || function.body.size() > INLINE_LIMIT ||
+        function.body.back().op != VMOp::RETURN) {
+        return;
+    }
+
+    InlineCandidate candidate{ { function.name, function.nLocals, {} }, subroutineArity };
+    for (size_t i = 0; i + 1 < function.body.size(); i++) {
+        const VMInstruction& instruction = function.body[i];
+        switch (instruction.op) {
+        case VMOp::LABEL:
+        case VMOp::GOTO:
+        case VMOp::IF_GOTO:
+        case VMOp::RETURN:
+        case VMOp::FUNCTION:
+            return;
+        case VMOp::POP:
+            if (instruction.segment == Segment::POINTER) return;
+            break;
+        case VMOp::NOP:
+            continue;
+        default:
+            break;
+        }
+        candidate.function.body.push_back(instruction);
+    }
+    inlineCandidates[function.name] = std::move(candidate);
+}
+
+// Горячий вызов короткой функции этого класса заменяется её телом:
+// аргументы и локальные переменные становятся локальными вызывающей
+bool CodeGenerator::inlineCall(const std::string& name, int nArgs) {
+    if (!inHotBlock()) return false;
+    auto it = inlineCandidates.find(name);
+    if (it == inlineCandidates.end() || it->second.arity != nArgs) return false;
+
+    const VMFunction& callee = it->second.function;
+    int base = symbolTable.varCount(VarKind::VAR) + extraLocals;
+    extraLocals += nArgs + callee.nLocals;
+
+    for (int i = nArgs - 1; i >= 0; i--) {
+        vmWriter.writePop("local", base + i);
+    }
+    for (int i = 0; i < callee.nLocals; i++) {
+        vmWriter.writePush("constant", 0);
+        vmWriter.writePop("local", base + nArgs + i);
+    }
+    for (VMInstruction instruction : callee.body) {
+        if (instruction.segment == Segment::ARGUMENT) {
+            instruction.segment = Segment::LOCAL;
+            instruction.index += base;
+        }
+        else if (instruction.segment == Segment::LOCAL) {
+            instruction.index += base + nArgs;
+        }
+        vmWriter.writeInstruction(instruction);
+    }
+    return true;
+}
+
+void CodeGenerator::emitString(std::string_view text) {
+    vmWriter.writePush("constant", static_cast<int>(text.length()));
+    vmWriter.writeCall("String.new", 1);
+    for (char c : text) {
+        vmWriter.writePush("constant", c);
+        vmWriter.writeCall("String.appendChar", 2);
+    }
+}
+
+// Горячий литерал, который только печатают, создаётся при первом
+// исполнении и дальше берётся из статической переменной
+void CodeGenerator::emitPooledString(std::string_view text) {
+    std::string name = "$string" + std::to_string(symbolTable.varCount(VarKind::STATIC));
+    symbolTable.define(name, "String", VarKind::STATIC);
+    int index = symbolTable.indexOf(name);
+    std::string label = generateLabel("STRING_POOL");
+
+    vmWriter.writePush("static", index);
+    vmWriter.writeIf(label);
+    emitString(text);
+    vmWriter.writePop("static", index);
+    vmWriter.writeLabel(label);
+    vmWriter.writePush("static", index);
+}
+
+std::string CodeGenerator::kindToSegment(VarKind kind) const {
+    switch (kind) {
+    case VarKind::STATIC: return "static";
+    case VarKind::FIELD:  return "this";
+    case VarKind::ARG:    return "argument";
+    case VarKind::VAR:    return "local";
+    default:
+        throw std::runtime_error("Invalid variable kind");
+    }
+}
+
+// Генерирует уникальные метки для управления потоком
+std::string CodeGenerator::generateLabel(const std::string& prefix) {
+    return className + "_" + prefix + "_" + std::to_string(labelCounter++);
+}
+
+bool CodeGenerator::isBuiltInClass(std::string_view className) {
+    static const std::unordered_set<std::string_view> builtInClasses = {
+        "Array", "Math", "Memory", "Screen",
+        "String", "Keyboard", "Sys", "Output"
+    };
+    return builtInClasses.count(className) != 0;
+}
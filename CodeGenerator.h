@@ -0,0 +1,165 @@
+﻿#pragma once
+#include "Ast.h"
+#include "SymbolTable.h"
+#include "VMWriter.h"
+#include "CompilerOptions.h"
+#include "PassManager.h"
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Генерация VM-кода по дереву. Используется и однопроходным
+// CompilationEngine (по одному оператору), и разбором в дерево (--ast).
+class CodeGenerator {
+public:
+    CodeGenerator(VMWriter& vmWriter,
+        SymbolTable& symbolTable,
+        const std::string& className,
+        const CompilerOptions& options = CompilerOptions());
+
+    // Проходы оптимизации ссылаются на генератор
+    CodeGenerator(const CodeGenerator&) = delete;
+    CodeGenerator& operator=(const CodeGenerator&) = delete;
+
+    void setClassName(std::string_view name);
+
+    // Строка исходника для следующих команд (карта строк .vmmap)
+    void setSourceLine(size_t line);
+
+    // Генерация по готовому дереву
+    void generateClass(const ClassDec& classDec);
+    void generateSubroutine(const SubroutineDec& subroutine);
+    void generateStatements(std::span<Statement* const> statements);
+    void generateStatement(const Statement& statement);
+
+    // Шаги, из которых однопроходный компилятор собирает подпрограмму
+    void defineVariables(std::span<const VariableDec> variables);
+    void beginSubroutine(const SubroutineDec& signature);
+    void beginBody();
+    void endSubroutine();
+
+    struct IfLabels {
+        std::string trueLabel;
+        std::string falseLabel;
+        std::string endLabel;
+        int block = 0;            // Номер блока then в профиле, else - следующий
+    };
+    IfLabels beginIf(const Expr* condition);
+    void beginElse(const IfLabels& labels);
+    void endIf(const IfLabels& labels);
+
+    struct WhileLabels {
+        std::string startLabel;
+        std::string endLabel;
+        size_t line = 0;          // Переход к условию относится к строке while
+    };
+    WhileLabels beginWhile(const Expr* condition);
+    void endWhile(const WhileLabels& labels);
+
+    void generateExpression(const Expr* expr);
+
+    static bool isBuiltInClass(std::string_view className);
+
+private:
+    struct ExprSummary {
+        int cost = 0;             // Примерное число VM-команд
+        bool hasCall = false;
+        bool sideEffects = false;
+        bool readsMemory = false; // Поля, статические, массивы, вызовы READS_MEMORY
+        bool mayFail = false;     // Деление или вызов *_MAY_FAIL
+
+        void merge(const ExprSummary& other) {
+            cost += other.cost;
+            hasCall = hasCall || other.hasCall;
+            sideEffects = sideEffects || other.sideEffects;
+            readsMemory = readsMemory || other.readsMemory;
+            mayFail = mayFail || other.mayFail;
+        }
+    };
+    // Открытый блок при обходе дерева операторов
+    struct Frame {
+        const Statement* owner;
+        std::span<Statement* const> statements;
+        size_t next = 0;
+        bool inElse = false;
+        IfLabels ifLabels;
+        WhileLabels whileLabels;
+    };
+
+    // Узел выражения, код операндов которого ещё генерируется
+    struct EmitFrame {
+        const Expr* expr;
+        size_t next;
+        ExprSummary summary;
+    };
+
+    struct AvailableExpression {
+        const Expr* expr;
+        size_t savePoint;         // Номер точки сохранения в теле функции
+        int local;                // Локальная переменная с результатом (-1 - ещё нет)
+        ExprSummary summary;
+        std::vector<std::string_view> variables;
+    };
+
+    void runFrames(std::vector<Frame>& frames);
+    void openFrame(std::vector<Frame>& frames, const Statement& statement);
+    void generateLet(const Statement& statement);
+    void generateDo(const Statement& statement);
+    void generateReturn(const Statement& statement);
+
+    // Генерация кода по дереву выражения с устранением общих
+    // подвыражений (CSE) внутри базового блока
+    // (обход выполняется на явном стеке, без рекурсии)
+    ExprSummary emitExpression(const Expr* expr, bool cacheRoot = true);
+    bool reuseExpression(const Expr* expr, ExprSummary& summary);
+    void recordExpression(const Expr* expr, const ExprSummary& summary);
+    ExprSummary beginTerm(const Expr* expr);
+    void finishTerm(const Expr* expr, ExprSummary& summary);
+    void emitOperator(std::string_view op);
+    void collectVariables(const Expr* expr, std::vector<std::string_view>& variables) const;
+    void invalidateVariable(std::string_view name);
+    void invalidateMemory();
+    void clearAvailableExpressions();
+
+    // Профиль: счётчики блоков (--instrument) и решения по ним (--profile-use)
+    void enterBlock(const std::string& site);
+    void leaveBlock();
+    std::string blockSite(int block) const;
+    bool inHotBlock() const;
+    void swapBranches(VMFunction& function, const IfLabels& labels) const;
+    void rememberInlineCandidate(const VMFunction& function);
+    bool inlineCall(const std::string& name, int nArgs);
+    void emitString(std::string_view text);
+    void emitPooledString(std::string_view text);
+
+    std::string kindToSegment(VarKind kind) const;
+    std::string generateLabel(const std::string& prefix);
+
+    VMWriter& vmWriter;
+    SymbolTable& symbolTable;
+    std::string className;
+    std::string currentSubroutine;
+    Keyword subroutineKind = Keyword::FUNCTION;
+    int labelCounter = 0;
+    size_t sourceLine = 0;
+    CompilerOptions options;
+    PassManager passes;
+    std::vector<AvailableExpression> availableExpressions;
+    int extraLocals = 0;            // Локальные переменные, выделенные компилятором
+    int statementCount = 0;         // Операторов в текущей подпрограмме
+    Purity returnPurity = Purity::IMPURE; // Побочные эффекты первого return
+
+    // Короткая функция без переходов, которую можно встроить в горячий вызов
+    struct InlineCandidate {
+        VMFunction function;
+        int arity;
+    };
+    int subroutineArity = 0;
+    int blockCounter = 0;           // Блоков профиля в текущей подпрограмме
+    std::vector<uint64_t> blockCounts;  // Исполнения открытых блоков по профилю
+    std::vector<IfLabels> hotElse;  // if, у которых else исполняется чаще then
+    std::unordered_map<std::string, InlineCandidate> inlineCandidates;
+    const Expr* printedLiteral = nullptr;   // Литерал - аргумент Output.printString
+};
@@ -2,8 +2,11 @@
 #include "JackTokenizer.h"
 #include "SymbolTable.h"
 #include "VMWriter.h"
+#include "Parser.h"
+#include "CodeGenerator.h"
+#include "CompilerOptions.h"
 #include <string>
-#include <memory>
+#include <vector>
 
 
 
@@ -12,9 +15,10 @@ public:
     CompilationEngine(JackTokenizer& tokenizer,
         VMWriter& vmWriter,
         SymbolTable& symbolTable,
-        const std::string& className);
+        const std::string& className,
+        const CompilerOptions& options = CompilerOptions());
 
-    //   
+    // Основные методы компиляции
     void compileClass();
     void compileClassVarDec();
     void compileSubroutine();
@@ -32,33 +36,23 @@ public:
     void compileSubroutineCall(const std::string& identifier);
 
 private:
-    //  
-
-    void expect(const std::string& expected);
-    void consumeSymbol(std::string symbol);
-    void consumeKeyword(Keyword keyword);
-    void eat();
-
-    //  VarKind  VM-
-
-    std::string kindToSegment(VarKind kind) const;
-
-    //   
-
-    std::string generateLabel(const std::string& prefix);
-    bool isOperator(std::string c) const;
-    bool isUnaryOp() const;
-    bool isBuiltInClass(const std::string& className) const;
-    void emitOperator(const std::string& op);
-
-    
-
-    // 
+    // Открытый блок if/while: вложенные блоки хранятся в явном стеке
+    struct OpenBlock {
+        const Statement* header;
+        bool inElse = false;
+        CodeGenerator::IfLabels ifLabels;
+        CodeGenerator::WhileLabels whileLabels;
+    };
+
+    void compileBlocks(std::vector<OpenBlock>& blocks, bool singleStatement);
+    void openBlock(std::vector<OpenBlock>& blocks, const Statement* header);
+    void closeBlock(std::vector<OpenBlock>& blocks);
+
+    // Состояние
     JackTokenizer& tokenizer;
-    VMWriter& vmWriter;
-    SymbolTable& symbolTable;
-    std::string className;
-    std::string currentSubroutine;
-    int labelCounter = 0;
-    int currentExpressionCount = 0; //    
+    Arena arena;                    // Деревья текущей подпрограммы
+    Parser parser;
+    CodeGenerator generator;
+    int currentExpressionCount = 0; // Для хранения количества аргументов
+    size_t maxDepth;
 };
\ No newline at end of file
@@ -0,0 +1,145 @@
+﻿#include "CompileStatistics.h"
+#include "CompilerOptions.h"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace {
+
+// Строка JSON с экранированием
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') out << '\\' << c;
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+                << std::dec << std::setfill(' ');
+        }
+        else out << c;
+    }
+    out << '"';
+}
+
+void writeJsonFile(std::ostream& out, const FileStatistics& file, const char* indent) {
+    out << indent << "{\"file\": ";
+    writeJsonString(out, file.file);
+    out << ", \"totalMs\": " << file.totalSeconds * 1000
+        << ", \"lexMs\": " << file.lexSeconds * 1000
+        << ", \"compileMs\": " << file.compileSeconds() * 1000
+        << ", \"writeMs\": " << file.writeSeconds * 1000
+        << ", \"tokens\": " << file.tokens
+        << ", \"symbols\": " << file.symbols
+        << ", \"labels\": " << file.instructions[static_cast<size_t>(VMOp::LABEL)]
+        << ", \"bytesWritten\": " << file.bytesWritten
+        << ", \"instructions\": " << file.instructionCount()
+        << ", \"opcodes\": {";
+    bool first = true;
+    for (size_t op = 0; op < VM_OP_COUNT; op++) {
+        if (static_cast<VMOp>(op) == VMOp::NOP) continue;
+        out << (first ? "" : ", ") << "\"" << opToString(static_cast<VMOp>(op)) << "\": " << file.instructions[op];
+        first = false;
+    }
+    out << "}, \"passes\": {";
+    for (size_t pass = 0; pass < OPTIMIZATION_PASS_COUNT; pass++) {
+        const PassStatistics& statistics = file.passes[pass];
+        out << (pass == 0 ? "" : ", ") << "\"" << PASS_NAMES[pass] << "\": {\"ms\": " << statistics.seconds * 1000
+            << ", \"runs\": " << statistics.runs << ", \"removed\": " << statistics.removed << "}";
+    }
+    out << "}}";
+}
+
+}
+
+double FileStatistics::compileSeconds() const {
+    return std::max(0.0, totalSeconds - lexSeconds - writeSeconds);
+}
+
+size_t FileStatistics::instructionCount() const {
+    return std::accumulate(instructions.begin(), instructions.end(), size_t{ 0 });
+}
+
+void CompileStatistics::add(FileStatistics file) {
+    files.push_back(std::move(file));
+}
+
+void CompileStatistics::setWallTime(double seconds) {
+    wallSeconds = seconds;
+}
+
+size_t CompileStatistics::tokenCount() const {
+    return total().tokens;
+}
+
+FileStatistics CompileStatistics::total() const {
+    FileStatistics sum;
+    sum.file = "total";
+    for (const auto& file : files) {
+        sum.totalSeconds += file.totalSeconds;
+        sum.lexSeconds += file.lexSeconds;
+        sum.writeSeconds += file.writeSeconds;
+        sum.tokens += file.tokens;
+        sum.symbols += file.symbols;
+        sum.bytesWritten += file.bytesWritten;
+        for (size_t op = 0; op < VM_OP_COUNT; op++) {
+            sum.instructions[op] += file.instructions[op];
+        }
+        for (size_t pass = 0; pass < OPTIMIZATION_PASS_COUNT; pass++) {
+            sum.passes[pass].seconds += file.passes[pass].seconds;
+            sum.passes[pass].runs += file.passes[pass].runs;
+            sum.passes[pass].removed += file.passes[pass].removed;
+        }
+    }
+    return sum;
+}
+
+void CompileStatistics::printText(std::ostream& out) const {
+    auto ms = [](double seconds) { return seconds * 1000; };
+    auto row = [&](const FileStatistics& file) {
+        out << std::left << std::setw(24) << file.file << std::right << std::fixed << std::setprecision(3)
+            << std::setw(10) << ms(file.totalSeconds) << std::setw(10) << ms(file.lexSeconds)
+            << std::setw(10) << ms(file.compileSeconds()) << std::setw(10) << ms(file.writeSeconds)
+            << std::setw(8) << file.tokens << std::setw(8) << file.symbols
+            << std::setw(8) << file.instructions[static_cast<size_t>(VMOp::LABEL)]
+            << std::setw(8) << file.instructionCount() << std::setw(10) << file.bytesWritten << "\n";
+    };
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::left << std::setw(24) << "file" << std::right
+        << std::setw(10) << "total ms" << std::setw(10) << "lex ms" << std::setw(10) << "parse ms"
+        << std::setw(10) << "write ms" << std::setw(8) << "tokens" << std::setw(8) << "symbols"
+        << std::setw(8) << "labels" << std::setw(8) << "vm ops" << std::setw(10) << "bytes" << "\n";
+    for (const auto& file : files) {
+        row(file);
+    }
+    FileStatistics sum = total();
+    row(sum);
+
+    out << "opcodes:";
+    for (size_t op = 0; op < VM_OP_COUNT; op++) {
+        if (static_cast<VMOp>(op) == VMOp::NOP || sum.instructions[op] == 0) continue;
+        out << " " << opToString(static_cast<VMOp>(op)) << "=" << sum.instructions[op];
+    }
+    out << "\npasses:";
+    for (size_t pass = 0; pass < OPTIMIZATION_PASS_COUNT; pass++) {
+        if (sum.passes[pass].runs == 0) continue;
+        out << " " << PASS_NAMES[pass] << "=" << std::setprecision(3) << ms(sum.passes[pass].seconds) << " ms/"
+            << sum.passes[pass].removed << " removed";
+    }
+    out << "\nwall time: " << std::setprecision(3) << ms(wallSeconds) << " ms\n";
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void CompileStatistics::printJson(std::ostream& out) const {
+    out << "{\n  \"version\": ";
+    writeJsonString(out, COMPILER_VERSION);
+    out << ",\n  \"wallMs\": " << wallSeconds * 1000 << ",\n  \"files\": [\n";
+    for (size_t i = 0; i < files.size(); i++) {
+        writeJsonFile(out, files[i], "    ");
+        out << (i + 1 < files.size() ? ",\n" : "\n");
+    }
+    out << "  ],\n  \"total\":\n";
+    writeJsonFile(out, total(), "    ");
+    out << "\n}\n";
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+#include "CompilerOptions.h"
+#include "VMInstruction.h"
+#include <array>
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+constexpr size_t VM_OP_COUNT = static_cast<size_t>(VMOp::NOP) + 1;
+
+// Проход оптимизации по всем подпрограммам файла (PassManager)
+struct PassStatistics {
+    double seconds = 0;
+    size_t runs = 0;
+    ptrdiff_t removed = 0;          // Удалено команд (отрицательное - добавлено)
+};
+
+// Время этапов и счётчики компиляции одного файла (--stats).
+// Лексер и VMWriter заполняют их, только если им передан указатель.
+struct FileStatistics {
+    std::string file;
+    double totalSeconds = 0;
+    double lexSeconds = 0;          // JackTokenizer::advance
+    double writeSeconds = 0;        // VMWriter: текст функций и закрытие файла
+    size_t tokens = 0;
+    size_t symbols = 0;             // Определения в таблице символов
+    size_t bytesWritten = 0;
+    std::array<size_t, VM_OP_COUNT> instructions{};    // Записанные команды по VMOp
+    std::array<PassStatistics, OPTIMIZATION_PASS_COUNT> passes{};
+
+    // Разбор и генерация кода (CompilationEngine): всё, кроме лексера и записи
+    double compileSeconds() const;
+    size_t instructionCount() const;
+};
+
+// Отчёт по сборке: по файлам и суммарно, текстом или JSON
+class CompileStatistics {
+public:
+    void add(FileStatistics file);
+    void setWallTime(double seconds);
+
+    void printText(std::ostream& out) const;
+    void printJson(std::ostream& out) const;
+
+    // Токены во всех файлах
+    size_t tokenCount() const;
+
+private:
+    FileStatistics total() const;
+
+    std::vector<FileStatistics> files;
+    double wallSeconds = 0;
+};
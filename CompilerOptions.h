@@ -0,0 +1,101 @@
+﻿#pragma once
+#include "Profile.h"
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Версия генератора кода: увеличивается при любом изменении выходного .vm
+constexpr const char* COMPILER_VERSION = "jackc 1.6";
+
+// Проходы оптимизации подпрограммы в порядке выполнения (PassManager.h)
+enum class OptimizationPass { PROFILE_LAYOUT, LICM, CFG, SUPERINSTRUCTIONS, COUNT };
+constexpr size_t OPTIMIZATION_PASS_COUNT = static_cast<size_t>(OptimizationPass::COUNT);
+
+// Имена проходов в командной строке (--enable-pass, --disable-pass, --dump-after)
+constexpr const char* PASS_NAMES[OPTIMIZATION_PASS_COUNT] = { "pgo-layout", "licm", "cfg", "super" };
+
+inline const char* passName(OptimizationPass pass) {
+    return PASS_NAMES[static_cast<size_t>(pass)];
+}
+
+// Настройки компиляции
+struct CompilerOptions {
+    // Устранение общих подвыражений внутри базового блока
+    bool eliminateCommonSubexpressions = true;
+    // Вынос инвариантов из циклов while
+    bool hoistLoopInvariants = true;
+    // Граф потока управления: сквозные переходы, инверсия ветвлений, раскладка блоков
+    bool optimizeControlFlow = true;
+    // Разбор всего файла в дерево (в арене), затем генерация кода по дереву
+    bool buildSyntaxTree = false;
+    // Предельная вложенность выражений и блоков (разбор идёт на явных стеках)
+    size_t maxNestingDepth = 100000;
+    // Отладочный вывод токенов, ключевых слов и вызовов (на .vm не влияет)
+    bool debugOutput = false;
+    // Двоичный VM-код (.vmb) вместо текста .vm
+    bool bytecodeOutput = false;
+    // Карта строк исходника для каждой команды (.vmmap рядом с .vm)
+    bool lineMap = false;
+    // Расширенный диалект VM с суперкомандами (inc, if-lt, load, store, ...)
+    bool superinstructions = false;
+    // Счётчики исполнения на входах подпрограмм и в блоках (вызовы Profile.count)
+    bool instrument = false;
+    // Профиль прошлого прогона: встраивание горячих вызовов, горячая ветка if
+    // первой, пул часто исполняемых строковых литералов
+    std::shared_ptr<const Profile> profile;
+    // Горячая ветка if первой (проход pgo-layout, нужен profile)
+    bool profileLayout = true;
+    // Проход, после которого функция выводится в stderr ("all" - после каждого)
+    std::string dumpAfter;
+
+    bool passEnabled(OptimizationPass pass) const {
+        switch (pass) {
+        case OptimizationPass::PROFILE_LAYOUT:    return profileLayout && profile != nullptr;
+        case OptimizationPass::LICM:              return hoistLoopInvariants;
+        case OptimizationPass::CFG:               return optimizeControlFlow;
+        case OptimizationPass::SUPERINSTRUCTIONS: return superinstructions;
+        default:                                  return false;
+        }
+    }
+
+    // Включает или выключает проход по имени; cse выполняется при генерации
+    // кода, а не отдельным проходом. false - неизвестное имя.
+    bool setPassEnabled(std::string_view name, bool enabled) {
+        if (name == "cse") eliminateCommonSubexpressions = enabled;
+        else if (name == "pgo-layout") profileLayout = enabled;
+        else if (name == "licm") hoistLoopInvariants = enabled;
+        else if (name == "cfg") optimizeControlFlow = enabled;
+        else if (name == "super") superinstructions = enabled;
+        else return false;
+        return true;
+    }
+
+    // Набор проходов уровня: O0 - без оптимизаций, O1 - только граф потока
+    // управления, Os - ещё cse (без licm, который добавляет код перед
+    // циклами), O2 - все (по умолчанию). Диалект super уровнем не включается.
+    // false - неизвестный уровень.
+    bool setOptimizationLevel(std::string_view level) {
+        if (level != "O0" && level != "O1" && level != "Os" && level != "O2") return false;
+        optimizeControlFlow = level != "O0";
+        eliminateCommonSubexpressions = level == "Os" || level == "O2";
+        hoistLoopInvariants = level == "O2";
+        profileLayout = level == "O2";
+        return true;
+    }
+
+    // Версия и настройки, от которых зависит результат (ключ кеша сборки)
+    std::string signature() const {
+        std::string result = COMPILER_VERSION;
+        if (eliminateCommonSubexpressions) result += " cse";
+        if (hoistLoopInvariants) result += " licm";
+        if (optimizeControlFlow) result += " cfg";
+        if (bytecodeOutput) result += " vmb";
+        if (superinstructions) result += " super";
+        if (instrument) result += " instrument";
+        if (profile) result += " profile=" + std::to_string(profile->hash());
+        if (profile && !profileLayout) result += " no-layout";
+        result += " depth=" + std::to_string(maxNestingDepth);
+        return result;
+    }
+};
@@ -0,0 +1,266 @@
+﻿#include "ControlFlowGraph.h"
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+bool isComparison(VMOp op) {
+    return op == VMOp::EQ || op == VMOp::LT || op == VMOp::GT;
+}
+
+// Инвертирует условие на вершине стека. "not" допустим только для канонических
+// true/false (eq/lt/gt и их отрицания), иначе сравнение с нулём.
+void invertCondition(std::vector<VMInstruction>& code) {
+    size_t n = code.size();
+    size_t nots = 0;
+    while (nots < n && code[n - 1 - nots].op == VMOp::NOT) nots++;
+
+    if (nots < n && isComparison(code[n - 1 - nots].op)) {
+        if (nots > 0) code.pop_back();
+        else code.push_back({ VMOp::NOT });
+    }
+    else {
+        code.push_back({ VMOp::PUSH, Segment::CONSTANT, 0 });
+        code.push_back({ VMOp::EQ });
+    }
+}
+
+}
+
+ControlFlowGraph::ControlFlowGraph(const VMFunction& function)
+    : functionName(function.name) {
+    std::unordered_map<std::string, int> labelBlocks;
+    std::vector<std::string> targetNames(1);
+    blocks.emplace_back();
+
+    auto startBlock = [&]() {
+        blocks.emplace_back();
+        targetNames.emplace_back();
+    };
+
+    for (const auto& instruction : function.body) {
+        switch (instruction.op) {
+        case VMOp::LABEL:
+            if (!blocks.back().code.empty()) startBlock();
+            blocks.back().labels.push_back(instruction.name);
+            labelBlocks[instruction.name] = static_cast<int>(blocks.size()) - 1;
+            break;
+        case VMOp::GOTO:
+        case VMOp::IF_GOTO:
+            blocks.back().exit = (instruction.op == VMOp::GOTO) ? Exit::GOTO : Exit::BRANCH;
+            targetNames.back() = instruction.name;
+            startBlock();
+            break;
+        case VMOp::RETURN:
+            blocks.back().exit = Exit::RETURN;
+            startBlock();
+            break;
+        case VMOp::NOP:
+            break;
+        default:
+            blocks.back().code.push_back(instruction);
+        }
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        BasicBlock& block = blocks[i];
+        if (block.exit == Exit::FALLTHROUGH || block.exit == Exit::BRANCH) {
+            block.next = (i + 1 < blocks.size()) ? static_cast<int>(i) + 1 : -1;
+        }
+        if (block.exit == Exit::GOTO || block.exit == Exit::BRANCH) {
+            auto it = labelBlocks.find(targetNames[i]);
+            if (it == labelBlocks.end()) {
+                throw std::runtime_error("Undefined label: " + targetNames[i]);
+            }
+            block.target = it->second;
+        }
+    }
+
+    for (size_t i = 0; i < blocks.size(); i++) {
+        order.push_back(static_cast<int>(i));
+    }
+}
+
+// Конечная цель перехода через цепочку пустых блоков
+int ControlFlowGraph::resolve(int block) const {
+    for (size_t steps = 0; block >= 0 && steps < blocks.size(); steps++) {
+        const BasicBlock& current = blocks[block];
+        if (!current.code.empty()) break;
+
+        int next;
+        if (current.exit == Exit::GOTO) next = current.target;
+        else if (current.exit == Exit::FALLTHROUGH) next = current.next;
+        else break;
+
+        if (next < 0 || next == block) break;
+        block = next;
+    }
+    return block;
+}
+
+void ControlFlowGraph::threadJumps() {
+    for (auto& block : blocks) {
+        switch (block.exit) {
+        case Exit::GOTO:
+            block.target = resolve(block.target);
+            break;
+        case Exit::FALLTHROUGH:
+            block.next = resolve(block.next);
+            break;
+        case Exit::BRANCH:
+            block.target = resolve(block.target);
+            block.next = resolve(block.next);
+            if (block.target == block.next) {
+                // Обе ветви ведут в один блок: условие не нужно
+                block.code.push_back({ VMOp::POP, Segment::TEMP, 0 });
+                block.exit = Exit::GOTO;
+                block.next = -1;
+            }
+            break;
+        case Exit::RETURN:
+            break;
+        }
+    }
+}
+
+void ControlFlowGraph::duplicateLoopConditions(size_t maxConditionSize) {
+    for (size_t i = 0; i < blocks.size(); i++) {
+        BasicBlock& latch = blocks[i];
+        if (latch.exit != Exit::GOTO || latch.target < 0 ||
+            static_cast<size_t>(latch.target) >= i) {
+            continue;
+        }
+
+        const BasicBlock& header = blocks[latch.target];
+        if (header.exit != Exit::BRANCH || header.code.size() > maxConditionSize) {
+            continue;
+        }
+
+        // Проверка условия в конце тела экономит goto на каждой итерации
+        latch.code.insert(latch.code.end(), header.code.begin(), header.code.end());
+        latch.exit = Exit::BRANCH;
+        latch.next = header.next;
+        latch.target = header.target;
+    }
+}
+
+std::vector<bool> ControlFlowGraph::reachable() const {
+    std::vector<bool> live(blocks.size(), false);
+    std::vector<int> work = { 0 };
+    while (!work.empty()) {
+        int b = work.back();
+        work.pop_back();
+        if (b < 0 || live[b]) continue;
+        live[b] = true;
+        work.push_back(blocks[b].next);
+        work.push_back(blocks[b].target);
+    }
+    return live;
+}
+
+void ControlFlowGraph::layout() {
+    std::vector<bool> live = reachable();
+    std::vector<bool> placed(blocks.size(), false);
+
+    // Блоки, в которые проваливается какой-то другой живой блок
+    std::vector<int> fallthroughPreds(blocks.size(), 0);
+    for (size_t i = 0; i < blocks.size(); i++) {
+        if (live[i] && blocks[i].next >= 0) fallthroughPreds[blocks[i].next]++;
+    }
+
+    // Исходный порядок, но цель goto ставится сразу за ним, если в неё
+    // не проваливается никакой другой блок
+    order.clear();
+    for (size_t start = 0; start < blocks.size(); start++) {
+        int b = static_cast<int>(start);
+        while (b >= 0 && live[b] && !placed[b]) {
+            placed[b] = true;
+            order.push_back(b);
+
+            const BasicBlock& block = blocks[b];
+            int follow = -1;
+            if (block.exit == Exit::GOTO && fallthroughPreds[block.target] == 0) {
+                follow = block.target;
+            }
+            else if (block.exit == Exit::FALLTHROUGH && block.next >= 0 &&
+                fallthroughPreds[block.next] == 1) {
+                follow = block.next;
+            }
+            b = follow;
+        }
+    }
+}
+
+std::string ControlFlowGraph::labelOf(int block) const {
+    const BasicBlock& b = blocks[block];
+    return b.labels.empty() ? functionName + "_BLOCK_" + std::to_string(block) : b.labels.front();
+}
+
+void ControlFlowGraph::emit(VMFunction& function) const {
+    // Переходы, которые останутся после раскладки
+    struct Jumps {
+        bool invert = false;
+        int ifTarget = -1;
+        int gotoTarget = -1;
+    };
+    std::vector<Jumps> jumps(order.size());
+    std::vector<bool> referenced(blocks.size(), false);
+
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        const BasicBlock& block = blocks[order[pos]];
+        int following = (pos + 1 < order.size()) ? order[pos + 1] : -1;
+        Jumps& j = jumps[pos];
+
+        switch (block.exit) {
+        case Exit::FALLTHROUGH:
+            if (block.next >= 0 && block.next != following) j.gotoTarget = block.next;
+            break;
+        case Exit::GOTO:
+            if (block.target != following) j.gotoTarget = block.target;
+            break;
+        case Exit::BRANCH:
+            if (block.next == following) {
+                j.ifTarget = block.target;
+            }
+            else if (block.target == following) {
+                j.invert = true;
+                j.ifTarget = block.next;
+            }
+            else {
+                j.ifTarget = block.target;
+                j.gotoTarget = block.next;
+            }
+            break;
+        case Exit::RETURN:
+            break;
+        }
+        if (j.ifTarget >= 0) referenced[j.ifTarget] = true;
+        if (j.gotoTarget >= 0) referenced[j.gotoTarget] = true;
+    }
+
+    std::vector<VMInstruction> body;
+    for (size_t pos = 0; pos < order.size(); pos++) {
+        int b = order[pos];
+        const BasicBlock& block = blocks[b];
+        const Jumps& j = jumps[pos];
+
+        if (referenced[b]) {
+            body.push_back({ VMOp::LABEL, Segment::NONE, 0, labelOf(b) });
+        }
+
+        std::vector<VMInstruction> code = block.code;
+        if (j.invert) invertCondition(code);
+        body.insert(body.end(), code.begin(), code.end());
+
+        if (j.ifTarget >= 0) {
+            body.push_back({ VMOp::IF_GOTO, Segment::NONE, 0, labelOf(j.ifTarget) });
+        }
+        if (j.gotoTarget >= 0) {
+            body.push_back({ VMOp::GOTO, Segment::NONE, 0, labelOf(j.gotoTarget) });
+        }
+        if (block.exit == Exit::RETURN) {
+            body.push_back({ VMOp::RETURN });
+        }
+    }
+    function.body.swap(body);
+}
@@ -0,0 +1,43 @@
+﻿#pragma once
+#include "VMInstruction.h"
+#include <string>
+#include <vector>
+
+// Граф потока управления одной подпрограммы из базовых блоков
+class ControlFlowGraph {
+public:
+    // Строит граф по буферу функции
+    explicit ControlFlowGraph(const VMFunction& function);
+
+    // Переходы на пустые блоки перенаправляются сразу на их цель
+    void threadJumps();
+
+    // Обратный переход цикла заменяется копией короткого условия цикла
+    void duplicateLoopConditions(size_t maxConditionSize = 16);
+
+    // Порядок блоков, при котором больше переходов становятся проваливанием
+    void layout();
+
+    // Записывает тело функции: инвертирует ветвления, опускает лишние goto
+    // и метки, на которые никто не ссылается
+    void emit(VMFunction& function) const;
+
+private:
+    enum class Exit { FALLTHROUGH, GOTO, BRANCH, RETURN };
+
+    struct BasicBlock {
+        std::vector<std::string> labels;
+        std::vector<VMInstruction> code;  // Без меток и завершающего перехода
+        Exit exit = Exit::FALLTHROUGH;
+        int target = -1;                  // goto или if-goto (условие истинно)
+        int next = -1;                    // Проваливание (условие ложно)
+    };
+
+    int resolve(int block) const;
+    std::vector<bool> reachable() const;
+    std::string labelOf(int block) const;
+
+    std::string functionName;
+    std::vector<BasicBlock> blocks;
+    std::vector<int> order;
+};
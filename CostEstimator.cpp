@@ -0,0 +1,222 @@
+﻿#include "CostEstimator.h"
+#include "CodeGenerator.h"
+#include "Superinstructions.h"
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <string_view>
+#include <unordered_map>
+
+namespace {
+
+// Команды Hack в стандартной трансляции одной команды VM
+size_t instructionCost(const VMInstruction& instruction) {
+    switch (instruction.op) {
+    case VMOp::PUSH:
+        switch (instruction.segment) {
+        case Segment::LOCAL:
+        case Segment::ARGUMENT:
+        case Segment::THIS:
+        case Segment::THAT:
+            return 10;
+        default:
+            return 7;
+        }
+    case VMOp::POP:
+        switch (instruction.segment) {
+        case Segment::LOCAL:
+        case Segment::ARGUMENT:
+        case Segment::THIS:
+        case Segment::THAT:
+            return 12;
+        default:
+            return 5;
+        }
+    case VMOp::ADD:
+    case VMOp::SUB:
+    case VMOp::AND:
+    case VMOp::OR:
+        return 5;
+    case VMOp::NEG:
+    case VMOp::NOT:
+        return 3;
+    case VMOp::EQ:
+    case VMOp::GT:
+    case VMOp::LT:
+        return 13;
+    case VMOp::GOTO:
+        return 2;
+    case VMOp::IF_GOTO:
+        return 5;
+    case VMOp::CALL:
+        return 44;          // Адрес возврата, LCL, ARG, THIS, THAT, новые ARG и LCL, переход
+    case VMOp::RETURN:
+        return 42;
+    default:
+        return 0;           // label, точки сохранения CSE
+    }
+}
+
+// Примерные такты функций ОС (стандартная реализация на Jack)
+uint64_t osCallCycles(const std::string& name) {
+    static const std::unordered_map<std::string_view, uint64_t> cycles = {
+        { "Math.multiply", 250 }, { "Math.divide", 400 }, { "Math.sqrt", 900 },
+        { "Math.abs", 30 }, { "Math.min", 30 }, { "Math.max", 30 },
+        { "Memory.alloc", 150 }, { "Memory.deAlloc", 60 }, { "Memory.peek", 20 }, { "Memory.poke", 25 },
+        { "Array.new", 180 }, { "Array.dispose", 80 },
+        { "String.new", 250 }, { "String.dispose", 90 }, { "String.length", 20 },
+        { "String.charAt", 30 }, { "String.setCharAt", 35 }, { "String.appendChar", 45 },
+        { "String.eraseLastChar", 25 }, { "String.intValue", 600 }, { "String.setInt", 900 },
+        { "String.backSpace", 10 }, { "String.doubleQuote", 10 }, { "String.newLine", 10 },
+        { "Output.printChar", 350 }, { "Output.printString", 1500 }, { "Output.printInt", 1800 },
+        { "Output.println", 100 }, { "Output.moveCursor", 100 }, { "Output.backSpace", 400 },
+        { "Screen.setColor", 10 }, { "Screen.drawPixel", 250 }, { "Screen.drawLine", 6000 },
+        { "Screen.drawRectangle", 30000 }, { "Screen.drawCircle", 40000 }, { "Screen.clearScreen", 60000 },
+        { "Keyboard.keyPressed", 15 }, { "Keyboard.readChar", 1000 },
+        { "Keyboard.readLine", 10000 }, { "Keyboard.readInt", 10000 },
+        { "Sys.wait", 1000 }, { "Sys.error", 100 }, { "Sys.halt", 0 },
+    };
+    std::string_view className = std::string_view(name).substr(0, name.find('.'));
+    if (!CodeGenerator::isBuiltInClass(className)) return 0;
+    auto it = cycles.find(name);
+    return it != cycles.end() ? it->second : 200;
+}
+
+// Вложенность циклов каждой команды: обратный переход охватывает
+// команды от своей метки до себя
+std::vector<int> loopDepths(const VMFunction& function, int& loops) {
+    const auto& body = function.body;
+    std::unordered_map<std::string, size_t> labels;
+    for (size_t i = 0; i < body.size(); i++) {
+        if (body[i].op == VMOp::LABEL) labels.emplace(body[i].name, i);
+    }
+
+    std::vector<int> depth(body.size() + 1, 0);
+    loops = 0;
+    for (size_t i = 0; i < body.size(); i++) {
+        if (body[i].op != VMOp::GOTO && body[i].op != VMOp::IF_GOTO) continue;
+        auto it = labels.find(body[i].name);
+        if (it == labels.end() || it->second > i) continue;
+        loops++;
+        depth[it->second]++;
+        depth[i + 1]--;
+    }
+    for (size_t i = 1; i < depth.size(); i++) {
+        depth[i] += depth[i - 1];
+    }
+    depth.pop_back();
+    return depth;
+}
+
+uint64_t weight(int depth) {
+    uint64_t result = 1;
+    for (int i = 0; i < depth && result < UINT64_MAX / LOOP_WEIGHT; i++) result *= LOOP_WEIGHT;
+    return result;
+}
+
+}
+
+size_t CostReport::totalInstructions() const {
+    size_t total = 0;
+    for (const auto& function : functions) total += function.instructions;
+    return total;
+}
+
+uint64_t CostReport::totalWeightedCycles() const {
+    uint64_t total = 0;
+    for (const auto& function : functions) total += function.weightedCycles;
+    return total;
+}
+
+CostReport estimateCosts(const std::vector<VMFunction>& functions) {
+    CostReport report;
+    std::map<std::pair<std::string, uint32_t>, LineCost> lines;
+
+    for (const auto& emitted : functions) {
+        // Суперкоманды стоят столько же, сколько их обычные последовательности
+        VMFunction function = emitted;
+        lowerSuperinstructions(function);
+
+        FunctionCost cost;
+        cost.name = function.name;
+        // function: метка и обнуление локальных (push constant 0)
+        cost.instructions = 7 * static_cast<size_t>(function.nLocals);
+        cost.cycles = cost.instructions;
+        cost.weightedCycles = cost.instructions;
+
+        std::string source = function.name.substr(0, function.name.find('.')) + ".jack";
+        std::vector<int> depths = loopDepths(function, cost.loops);
+        uint32_t line = 0;
+        for (size_t i = 0; i < function.body.size(); i++) {
+            const VMInstruction& instruction = function.body[i];
+            size_t instructions = instructionCost(instruction);
+            uint64_t cycles = instructions;
+            if (instruction.op == VMOp::CALL) cycles += osCallCycles(instruction.name);
+            uint64_t weighted = cycles * weight(depths[i]);
+
+            cost.instructions += instructions;
+            cost.cycles += cycles;
+            cost.weightedCycles += weighted;
+            cost.maxDepth = std::max(cost.maxDepth, depths[i]);
+
+            if (instruction.line != 0) line = instruction.line;
+            if (line == 0 || weighted == 0) continue;
+            LineCost& lineCost = lines[{ source, line }];
+            lineCost.source = source;
+            lineCost.line = line;
+            lineCost.function = function.name;
+            lineCost.weightedCycles += weighted;
+            lineCost.depth = std::max(lineCost.depth, depths[i]);
+        }
+        report.functions.push_back(std::move(cost));
+    }
+
+    for (auto& [key, lineCost] : lines) {
+        report.lines.push_back(std::move(lineCost));
+    }
+    return report;
+}
+
+void printCostReport(std::ostream& out, const CostReport& report, size_t top) {
+    auto ranked = [&](auto key) {
+        std::vector<const FunctionCost*> order;
+        for (const auto& function : report.functions) order.push_back(&function);
+        std::stable_sort(order.begin(), order.end(), [&](const FunctionCost* a, const FunctionCost* b) {
+            return key(*a) > key(*b);
+        });
+        if (order.size() > top) order.resize(top);
+        return order;
+    };
+    auto printFunctions = [&](const char* title, const std::vector<const FunctionCost*>& order) {
+        out << title << "\n"
+            << std::left << std::setw(40) << "function" << std::right << std::setw(10) << "instrs"
+            << std::setw(12) << "cycles" << std::setw(14) << "weighted" << std::setw(7) << "loops" << "\n";
+        for (const FunctionCost* function : order) {
+            out << std::left << std::setw(40) << function->name << std::right
+                << std::setw(10) << function->instructions << std::setw(12) << function->cycles
+                << std::setw(14) << function->weightedCycles << std::setw(7) << function->loops << "\n";
+        }
+        out << "\n";
+    };
+
+    out << "Static cost: " << report.functions.size() << " function(s), " << report.totalInstructions()
+        << " Hack instructions, " << report.totalWeightedCycles() << " weighted cycles"
+        << " (loops x" << LOOP_WEIGHT << " per level)\n\n";
+    printFunctions("By cycles:", ranked([](const FunctionCost& cost) { return cost.cycles; }));
+    printFunctions("By loop-weighted cycles:", ranked([](const FunctionCost& cost) { return cost.weightedCycles; }));
+
+    std::vector<const LineCost*> lines;
+    for (const auto& line : report.lines) lines.push_back(&line);
+    std::stable_sort(lines.begin(), lines.end(), [](const LineCost* a, const LineCost* b) {
+        return a->weightedCycles > b->weightedCycles;
+    });
+    if (lines.size() > top) lines.resize(top);
+    out << "Most expensive lines:\n";
+    for (const LineCost* line : lines) {
+        std::string location = line->source + ":" + std::to_string(line->line);
+        out << std::left << std::setw(24) << location << std::setw(32) << line->function << std::right
+            << std::setw(14) << line->weightedCycles;
+        if (line->depth > 0) out << "  loop depth " << line->depth;
+        out << "\n";
+    }
+}
@@ -0,0 +1,47 @@
+﻿#pragma once
+#include "VMInstruction.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Статическая оценка стоимости VM-кода в командах и тактах Hack.
+// Стоимость команды VM берётся по стандартной трансляции (шаблоны книги
+// nand2tetris), вызов функции ОС добавляет её примерную стоимость в тактах.
+// Обратный переход на метку выше по коду считается циклом: команды
+// внутри него весят LOOP_WEIGHT за каждый уровень вложенности.
+
+constexpr uint64_t LOOP_WEIGHT = 10;
+
+struct FunctionCost {
+    std::string name;
+    size_t instructions = 0;        // Команд Hack (размер ROM)
+    uint64_t cycles = 0;            // Тактов за один проход тела, вместе с вызовами ОС
+    uint64_t weightedCycles = 0;    // То же с весом циклов
+    int loops = 0;
+    int maxDepth = 0;               // Наибольшая вложенность циклов
+};
+
+// Стоимость одной строки исходника (по строкам команд, VMInstruction::line)
+struct LineCost {
+    std::string source;             // Класс.jack
+    uint32_t line = 0;
+    std::string function;
+    uint64_t weightedCycles = 0;
+    int depth = 0;
+};
+
+struct CostReport {
+    std::vector<FunctionCost> functions;
+    std::vector<LineCost> lines;
+
+    size_t totalInstructions() const;
+    uint64_t totalWeightedCycles() const;
+};
+
+CostReport estimateCosts(const std::vector<VMFunction>& functions);
+
+// Рейтинги функций по тактам и по тактам с весом циклов, затем самые
+// дорогие строки исходника; top - длина каждого списка
+void printCostReport(std::ostream& out, const CostReport& report, size_t top);
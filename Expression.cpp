@@ -0,0 +1,41 @@
+﻿#include "Expression.h"
+#include <functional>
+#include <utility>
+#include <vector>
+
+static size_t combine(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+void hashExpr(Expr* expr) {
+    std::hash<std::string_view> hashString;
+    size_t h = static_cast<size_t>(expr->kind);
+    h = combine(h, hashString(expr->op));
+    h = combine(h, hashString(expr->name));
+    h = combine(h, hashString(expr->qualifier));
+    h = combine(h, static_cast<size_t>(expr->value));
+    h = combine(h, static_cast<size_t>(expr->keyword));
+    for (const Expr* operand : expr->operands) {
+        h = combine(h, operand->hash);
+    }
+    expr->hash = h;
+}
+
+bool sameExpr(const Expr* a, const Expr* b) {
+    std::vector<std::pair<const Expr*, const Expr*>> pending = { { a, b } };
+    while (!pending.empty()) {
+        auto [x, y] = pending.back();
+        pending.pop_back();
+        if (x == y) continue;
+        if (x->hash != y->hash || x->kind != y->kind ||
+            x->value != y->value || x->keyword != y->keyword ||
+            x->op != y->op || x->name != y->name || x->qualifier != y->qualifier ||
+            x->operands.size() != y->operands.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < x->operands.size(); i++) {
+            pending.emplace_back(x->operands[i], y->operands[i]);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,31 @@
+﻿#pragma once
+#include "JackTokenizer.h"
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+// Вид узла дерева выражения
+enum class ExprKind {
+    INT_CONST, STRING_CONST, KEYWORD_CONST,
+    VARIABLE, ARRAY_ACCESS, SUBROUTINE_CALL,
+    UNARY_OP, BINARY_OP
+};
+
+// Узел дерева выражения. Узлы и строки живут в арене (Arena.h),
+// поэтому узел хранит только представления и не имеет деструктора.
+struct Expr {
+    ExprKind kind;
+    std::string_view op;          // Оператор UNARY_OP/BINARY_OP
+    std::string_view name;        // Переменная, подпрограмма или строковая константа
+    std::string_view qualifier;   // Класс или переменная перед '.' в вызове
+    int value = 0;                // Целая константа
+    Keyword keyword = Keyword::NULL_;
+    std::span<Expr*> operands;    // Операнды, индекс массива или аргументы вызова
+    size_t hash = 0;              // Структурный хеш поддерева (для CSE)
+};
+
+// Вычисляет хеш узла по уже посчитанным хешам операндов
+void hashExpr(Expr* expr);
+
+// Структурное равенство двух поддеревьев (без рекурсии)
+bool sameExpr(const Expr* a, const Expr* b);
@@ -0,0 +1,143 @@
+﻿#include "FileWatcher.h"
+#include <set>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Пауза, в течение которой события считаются одним изменением
+constexpr int SETTLE_MILLISECONDS = 20;
+
+}
+
+bool FileWatcher::isWatched(const fs::path& file) const {
+    if (!singleFile.empty()) return file.filename() == singleFile.filename();
+    return file.extension() == ".jack";
+}
+
+#ifdef __linux__
+
+FileWatcher::FileWatcher(const fs::path& path) {
+    if (fs::is_directory(path)) {
+        directory = path;
+    }
+    else {
+        directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+        singleFile = path;
+    }
+
+    descriptor = inotify_init1(IN_CLOEXEC);
+    if (descriptor < 0) {
+        throw std::runtime_error("inotify_init1 failed");
+    }
+    uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+    if (inotify_add_watch(descriptor, directory.c_str(), mask) < 0) {
+        close(descriptor);
+        throw std::runtime_error("Failed to watch directory: " + directory.string());
+    }
+}
+
+FileWatcher::~FileWatcher() {
+    if (descriptor >= 0) close(descriptor);
+}
+
+FileWatcher::Changes FileWatcher::wait() {
+    std::set<fs::path> changed;
+    std::set<fs::path> removed;
+
+    alignas(inotify_event) char buffer[4096];
+    int timeout = -1;
+    for (;;) {
+        pollfd request = { descriptor, POLLIN, 0 };
+        int ready = poll(&request, 1, timeout);
+        if (ready < 0) continue;
+        if (ready == 0) {
+            if (!changed.empty() || !removed.empty()) break;
+            timeout = -1;
+            continue;
+        }
+
+        ssize_t length = read(descriptor, buffer, sizeof(buffer));
+        if (length <= 0) continue;
+        for (char* p = buffer; p < buffer + length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+            p += sizeof(inotify_event) + event->len;
+            if (event->len == 0) continue;
+
+            fs::path file = directory / event->name;
+            if (!isWatched(file)) continue;
+            if (!singleFile.empty()) file = singleFile;
+            if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                changed.insert(file);
+                removed.erase(file);
+            }
+            else {
+                removed.insert(file);
+                changed.erase(file);
+            }
+        }
+        timeout = SETTLE_MILLISECONDS;
+    }
+
+    return { { changed.begin(), changed.end() }, { removed.begin(), removed.end() } };
+}
+
+#else
+
+FileWatcher::FileWatcher(const fs::path& path) {
+    if (fs::is_directory(path)) {
+        directory = path;
+    }
+    else {
+        directory = path.has_parent_path() ? path.parent_path() : fs::path(".");
+        singleFile = path;
+    }
+    modified = scan();
+}
+
+FileWatcher::~FileWatcher() {
+}
+
+std::map<fs::path, fs::file_time_type> FileWatcher::scan() const {
+    std::map<fs::path, fs::file_time_type> result;
+    std::error_code error;
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+        if (entry.is_regular_file(error) && isWatched(entry.path())) {
+            result[singleFile.empty() ? entry.path() : singleFile] = entry.last_write_time(error);
+        }
+    }
+    return result;
+}
+
+FileWatcher::Changes FileWatcher::wait() {
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        auto current = scan();
+        if (current == modified) continue;
+
+        // Дождаться, пока файлы перестанут меняться
+        std::this_thread::sleep_for(std::chrono::milliseconds(SETTLE_MILLISECONDS));
+        current = scan();
+
+        Changes changes;
+        for (const auto& [file, time] : current) {
+            auto it = modified.find(file);
+            if (it == modified.end() || it->second != time) changes.changed.push_back(file);
+        }
+        for (const auto& [file, time] : modified) {
+            if (current.find(file) == current.end()) changes.removed.push_back(file);
+        }
+        modified = std::move(current);
+        if (!changes.changed.empty() || !changes.removed.empty()) return changes;
+    }
+}
+
+#endif
@@ -0,0 +1,38 @@
+﻿#pragma once
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <vector>
+
+// Наблюдение за .jack файлами каталога (или одним файлом).
+// В Linux используется inotify, в остальных системах - опрос
+// времени изменения файлов.
+class FileWatcher {
+public:
+    explicit FileWatcher(const std::filesystem::path& path);
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    struct Changes {
+        std::vector<std::filesystem::path> changed;     // Созданы или перезаписаны
+        std::vector<std::filesystem::path> removed;     // Удалены или переименованы
+    };
+
+    // Ждёт изменений. События, пришедшие почти одновременно (сохранение
+    // в редакторе через временный файл), объединяются.
+    Changes wait();
+
+private:
+    bool isWatched(const std::filesystem::path& file) const;
+
+    std::filesystem::path directory;
+    std::filesystem::path singleFile;       // Пусто, если наблюдаем каталог
+#ifdef __linux__
+    int descriptor = -1;
+#else
+    std::map<std::filesystem::path, std::filesystem::file_time_type> modified;
+    std::map<std::filesystem::path, std::filesystem::file_time_type> scan() const;
+#endif
+};
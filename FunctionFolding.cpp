@@ -0,0 +1,132 @@
+﻿#include "FunctionFolding.h"
+#include "Hash.h"
+#include <sstream>
+#include <unordered_map>
+
+namespace {
+
+const char* const SELF_CALL = "$self";
+
+bool isEntryPoint(const std::string& name) {
+    return name == "Sys.init" || name == "Main.main";
+}
+
+bool hasLabel(VMOp op) {
+    switch (op) {
+    case VMOp::LABEL:
+    case VMOp::GOTO:
+    case VMOp::IF_GOTO:
+    case VMOp::IF_EQ:
+    case VMOp::IF_NE:
+    case VMOp::IF_LT:
+    case VMOp::IF_GT:
+    case VMOp::IF_LE:
+    case VMOp::IF_GE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Текст тела без имён меток и собственного имени
+std::string normalizedBody(const VMFunction& function) {
+    std::ostringstream text;
+    text << "locals " << function.nLocals << "\n";
+    std::unordered_map<std::string, size_t> labels;
+    bool usesStatic = false;
+    for (const auto& instruction : function.body) {
+        if (instruction.op == VMOp::NOP) continue;
+        VMInstruction normalized = instruction;
+        if (hasLabel(instruction.op)) {
+            normalized.name = "L" + std::to_string(labels.emplace(instruction.name, labels.size()).first->second);
+        }
+        else if (instruction.op == VMOp::CALL && instruction.name == function.name) {
+            normalized.name = SELF_CALL;
+        }
+        usesStatic = usesStatic || instruction.segment == Segment::STATIC;
+        writeInstructionText(text, normalized);
+    }
+    // static - переменные своего класса
+    if (usesStatic) text << "class " << function.name.substr(0, function.name.find('.')) << "\n";
+    return text.str();
+}
+
+size_t instructionCount(const VMFunction& function) {
+    size_t count = 1;
+    for (const auto& instruction : function.body) {
+        if (instruction.op != VMOp::NOP) count++;
+    }
+    return count;
+}
+
+// Один проход: дубликат -> оставляемая функция
+std::unordered_map<std::string, std::string> findDuplicates(const std::vector<const VMFunction*>& functions) {
+    struct Canonical {
+        std::string body;
+        const VMFunction* function;
+    };
+    std::unordered_map<uint64_t, std::vector<Canonical>> canonical;
+    std::unordered_map<std::string, std::string> duplicates;
+    for (const VMFunction* function : functions) {
+        std::string body = normalizedBody(*function);
+        auto& candidates = canonical[xxhash64(body)];
+        const Canonical* match = nullptr;
+        for (const auto& candidate : candidates) {
+            if (candidate.body == body) match = &candidate;
+        }
+        if (match == nullptr) {
+            candidates.push_back({ std::move(body), function });
+        }
+        else if (!isEntryPoint(function->name) && function->name != match->function->name) {
+            duplicates.emplace(function->name, match->function->name);
+        }
+    }
+    return duplicates;
+}
+
+void redirectCalls(VMFunction& function, const std::unordered_map<std::string, std::string>& duplicates) {
+    for (auto& instruction : function.body) {
+        if (instruction.op != VMOp::CALL) continue;
+        auto it = duplicates.find(instruction.name);
+        if (it != duplicates.end()) instruction.name = it->second;
+    }
+}
+
+// Свёртка по всем функциям всех групп (классов)
+FoldStatistics fold(const std::vector<std::vector<VMFunction>*>& groups) {
+    FoldStatistics statistics;
+    for (;;) {
+        std::vector<const VMFunction*> all;
+        for (const auto* functions : groups) {
+            for (const auto& function : *functions) all.push_back(&function);
+        }
+        auto duplicates = findDuplicates(all);
+        if (duplicates.empty()) return statistics;
+
+        for (auto* functions : groups) {
+            std::vector<VMFunction> kept;
+            for (auto& function : *functions) {
+                if (duplicates.count(function.name) != 0) {
+                    statistics.functions++;
+                    statistics.instructions += instructionCount(function);
+                    continue;
+                }
+                redirectCalls(function, duplicates);
+                kept.push_back(std::move(function));
+            }
+            functions->swap(kept);
+        }
+    }
+}
+
+}
+
+FoldStatistics foldIdenticalFunctions(std::vector<VMFunction>& functions) {
+    return fold({ &functions });
+}
+
+FoldStatistics foldIdenticalFunctions(std::vector<CompiledClass>& classes) {
+    std::vector<std::vector<VMFunction>*> groups;
+    for (auto& compiled : classes) groups.push_back(&compiled.functions);
+    return fold(groups);
+}
@@ -0,0 +1,24 @@
+﻿#pragma once
+#include "JackCompiler.h"
+#include "VMInstruction.h"
+#include <cstddef>
+#include <vector>
+
+// Свёртка одинаковых функций при связывании всей программы. Тело функции
+// нормализуется: метки нумеруются по порядку появления, вызов самой себя
+// заменяется общим именем, точки сохранения CSE и строки исходника не
+// учитываются. Функции с одинаковым хешем (и текстом) нормализованного тела
+// сводятся к первой из них: вызовы дубликатов перенаправляются на неё,
+// а сами дубликаты удаляются. Функции с static сравниваются только внутри
+// своего класса, точки входа (Sys.init, Main.main) не удаляются. Свёртка
+// повторяется, пока после перенаправления вызовов появляются новые дубликаты.
+
+struct FoldStatistics {
+    size_t functions = 0;       // Удалено функций
+    size_t instructions = 0;    // Удалено команд VM (вместе с командами function)
+};
+
+FoldStatistics foldIdenticalFunctions(std::vector<VMFunction>& functions);
+
+// То же для классов бандла (подходит как LinkPass)
+FoldStatistics foldIdenticalFunctions(std::vector<CompiledClass>& classes);
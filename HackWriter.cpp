@@ -0,0 +1,456 @@
+﻿#include "HackWriter.h"
+#include "Superinstructions.h"
+#include <stdexcept>
+
+namespace {
+
+const int TEMP_BASE = 5;
+// Дальше этого смещения адрес сегмента считается через D, а не цепочкой A=A+1
+const int MAX_INCREMENTS = 3;
+
+const char* segmentBase(Segment segment) {
+    switch (segment) {
+    case Segment::LOCAL:    return "LCL";
+    case Segment::ARGUMENT: return "ARG";
+    case Segment::THIS:     return "THIS";
+    case Segment::THAT:     return "THAT";
+    default:                return nullptr;
+    }
+}
+
+// Условие перехода по D = x - y для сравнения
+const char* jumpCondition(VMOp op, bool inverted) {
+    switch (op) {
+    case VMOp::EQ: return inverted ? "JNE" : "JEQ";
+    case VMOp::GT: return inverted ? "JLE" : "JGT";
+    case VMOp::LT: return inverted ? "JGE" : "JLT";
+    default:
+        throw std::runtime_error("Invalid comparison");
+    }
+}
+
+bool isComparison(VMOp op) {
+    return op == VMOp::EQ || op == VMOp::GT || op == VMOp::LT;
+}
+
+// Бинарные команды, которые могут взять второй операнд прямо из памяти
+bool isFusible(VMOp op) {
+    return op == VMOp::ADD || op == VMOp::SUB || op == VMOp::AND || op == VMOp::OR || isComparison(op);
+}
+
+// D = D op operand, где operand - "A" или "M"
+std::string combine(VMOp op, const char* operand) {
+    std::string m = operand;
+    switch (op) {
+    case VMOp::ADD: return "D=D+" + m;
+    case VMOp::AND: return "D=D&" + m;
+    case VMOp::OR:  return "D=D|" + m;
+    default:        return "D=D-" + m;      // sub и сравнения
+    }
+}
+
+// D = M op D: x в памяти, y в D
+std::string combineStack(VMOp op) {
+    switch (op) {
+    case VMOp::ADD: return "D=D+M";
+    case VMOp::AND: return "D=D&M";
+    case VMOp::OR:  return "D=D|M";
+    default:        return "D=M-D";
+    }
+}
+
+}
+
+HackWriter::HackWriter(std::ostream& o) : out(o) {
+}
+
+void HackWriter::emit(const std::string& instruction) {
+    out << instruction << "\n";
+    instructions++;
+}
+
+void HackWriter::label(const std::string& name) {
+    out << "(" << name << ")\n";
+}
+
+size_t HackWriter::instructionCount() const {
+    return instructions;
+}
+
+std::vector<std::string> HackWriter::undefinedFunctions() const {
+    std::vector<std::string> result;
+    for (const auto& name : called) {
+        if (!defined.count(name)) result.push_back(name);
+    }
+    return result;
+}
+
+void HackWriter::ensureCached() {
+    if (cached) return;
+    emit("@SP");
+    emit("AM=M-1");
+    emit("D=M");
+    cached = true;
+}
+
+void HackWriter::flush() {
+    if (!cached) return;
+    emit("@SP");
+    emit("AM=M+1");
+    emit("A=A-1");
+    emit("M=D");
+    cached = false;
+}
+
+std::string HackWriter::symbol(const VMInstruction& instruction) const {
+    switch (instruction.segment) {
+    case Segment::STATIC:  return "@" + className + "." + std::to_string(instruction.index);
+    case Segment::TEMP:
+        if (instruction.index < 0 || instruction.index > 7) {
+            throw std::runtime_error("Invalid temp index in " + functionName);
+        }
+        return "@" + std::to_string(TEMP_BASE + instruction.index);
+    case Segment::POINTER:
+        if (instruction.index != 0 && instruction.index != 1) {
+            throw std::runtime_error("Invalid pointer index in " + functionName);
+        }
+        return instruction.index == 0 ? "@THIS" : "@THAT";
+    default:
+        return std::string();
+    }
+}
+
+bool HackWriter::address(const VMInstruction& instruction) {
+    std::string direct = symbol(instruction);
+    if (!direct.empty()) {
+        emit(direct);
+        return true;
+    }
+    const char* base = segmentBase(instruction.segment);
+    if (base == nullptr || instruction.index < 0 || instruction.index > MAX_INCREMENTS) {
+        return false;
+    }
+    emit(std::string("@") + base);
+    emit(instruction.index == 0 ? "A=M" : "A=M+1");
+    for (int i = 1; i < instruction.index; i++) {
+        emit("A=A+1");
+    }
+    return true;
+}
+
+void HackWriter::load(const VMInstruction& push) {
+    if (push.segment == Segment::CONSTANT) {
+        if (push.index == 0 || push.index == 1) {
+            emit(push.index == 0 ? "D=0" : "D=1");
+        }
+        else {
+            emit("@" + std::to_string(push.index));
+            emit("D=A");
+        }
+        return;
+    }
+    if (!address(push)) {
+        const char* base = segmentBase(push.segment);
+        if (base == nullptr) {
+            throw std::runtime_error("Invalid segment in " + functionName);
+        }
+        emit(std::string("@") + base);
+        emit("D=M");
+        emit("@" + std::to_string(push.index));
+        emit("A=D+A");
+    }
+    emit("D=M");
+}
+
+void HackWriter::store(const VMInstruction& pop) {
+    if (pop.segment == Segment::CONSTANT) {
+        throw std::runtime_error("Cannot pop to constant in " + functionName);
+    }
+    if (address(pop)) {
+        emit("M=D");
+        return;
+    }
+    const char* base = segmentBase(pop.segment);
+    if (base == nullptr) {
+        throw std::runtime_error("Invalid segment in " + functionName);
+    }
+    // Значение в R13, адрес в R14
+    emit("@R13");
+    emit("M=D");
+    emit(std::string("@") + base);
+    emit("D=M");
+    emit("@" + std::to_string(pop.index));
+    emit("D=D+A");
+    emit("@R14");
+    emit("M=D");
+    emit("@R13");
+    emit("D=M");
+    emit("@R14");
+    emit("A=M");
+    emit("M=D");
+}
+
+void HackWriter::writeCall(const std::string& name, int nArgs) {
+    flush();
+    called.insert(name);
+    std::string returnLabel = functionName + "$ret." + std::to_string(labelCounter++);
+    emit("@" + returnLabel);
+    emit("D=A");
+    emit("@R13");
+    emit("M=D");
+    emit("@" + name);
+    emit("D=A");
+    emit("@R14");
+    emit("M=D");
+    if (nArgs == 0 || nArgs == 1) {
+        emit(nArgs == 0 ? "D=0" : "D=1");
+    }
+    else {
+        emit("@" + std::to_string(nArgs));
+        emit("D=A");
+    }
+    emit("@$CALL");
+    emit("0;JMP");
+    label(returnLabel);
+    // Возвращённое значение в D, SP указывает на место бывших аргументов
+    cached = true;
+}
+
+void HackWriter::writeBootstrap(const std::string& entry) {
+    functionName = "$BOOT";
+    labelCounter = 0;
+    emit("@256");
+    emit("D=A");
+    emit("@SP");
+    emit("M=D");
+    cached = false;
+    writeCall(entry, 0);
+    label("$HALT");
+    emit("@$HALT");
+    emit("0;JMP");
+    cached = false;
+}
+
+void HackWriter::writeFunction(const VMFunction& function) {
+    // Суперкоманды транслируются как их обычные последовательности
+    if (hasSuperinstructions(function)) {
+        VMFunction plain = function;
+        lowerSuperinstructions(plain);
+        writeFunction(plain);
+        return;
+    }
+
+    functionName = function.name;
+    className = function.name.substr(0, function.name.find('.'));
+    labelCounter = 0;
+    cached = false;
+    defined.insert(function.name);
+
+    label(function.name);
+    if (function.nLocals > 0) {
+        emit("@SP");
+        emit("A=M");
+        emit("M=0");
+        for (int i = 1; i < function.nLocals; i++) {
+            emit("A=A+1");
+            emit("M=0");
+        }
+        emit("D=A+1");
+        emit("@SP");
+        emit("M=D");
+    }
+
+    std::vector<const VMInstruction*> body;
+    for (const auto& instruction : function.body) {
+        if (instruction.op != VMOp::NOP) body.push_back(&instruction);
+    }
+    auto at = [&](size_t i) -> const VMInstruction* { return i < body.size() ? body[i] : nullptr; };
+
+    for (size_t i = 0; i < body.size(); i++) {
+        const VMInstruction& instruction = *body[i];
+        VMOp op = instruction.op;
+
+        // Сравнение, за которым идёт if-goto (возможно через not), - условный переход
+        auto finishComparison = [&](VMOp comparison) {
+            const VMInstruction* next = at(i + 1);
+            bool inverted = next != nullptr && next->op == VMOp::NOT && at(i + 2) != nullptr &&
+                at(i + 2)->op == VMOp::IF_GOTO;
+            const VMInstruction* jump = inverted ? at(i + 2) : next;
+            if (jump != nullptr && jump->op == VMOp::IF_GOTO) {
+                emit("@" + functionName + "$" + jump->name);
+                emit(std::string("D;") + jumpCondition(comparison, inverted));
+                cached = false;
+                i += inverted ? 2 : 1;
+                return;
+            }
+            std::string suffix = std::to_string(labelCounter++);
+            std::string trueLabel = functionName + "$true." + suffix;
+            std::string endLabel = functionName + "$end." + suffix;
+            emit("@" + trueLabel);
+            emit(std::string("D;") + jumpCondition(comparison, false));
+            emit("D=0");
+            emit("@" + endLabel);
+            emit("0;JMP");
+            label(trueLabel);
+            emit("D=-1");
+            label(endLabel);
+            cached = true;
+        };
+
+        switch (op) {
+        case VMOp::PUSH: {
+            // push операнда прямо перед бинарной командой: операнд берётся из памяти
+            const VMInstruction* next = at(i + 1);
+            if (cached && next != nullptr && isFusible(next->op)) {
+                if (instruction.segment == Segment::CONSTANT) {
+                    emit("@" + std::to_string(instruction.index));
+                    emit(combine(next->op, "A"));
+                    i++;
+                    if (isComparison(next->op)) finishComparison(next->op);
+                    break;
+                }
+                if (address(instruction)) {
+                    emit(combine(next->op, "M"));
+                    i++;
+                    if (isComparison(next->op)) finishComparison(next->op);
+                    break;
+                }
+            }
+            flush();
+            load(instruction);
+            cached = true;
+            break;
+        }
+        case VMOp::POP:
+            ensureCached();
+            store(instruction);
+            cached = false;
+            break;
+        case VMOp::ADD:
+        case VMOp::SUB:
+        case VMOp::AND:
+        case VMOp::OR:
+        case VMOp::EQ:
+        case VMOp::GT:
+        case VMOp::LT:
+            ensureCached();
+            emit("@SP");
+            emit("AM=M-1");
+            emit(combineStack(op));
+            if (isComparison(op)) finishComparison(op);
+            break;
+        case VMOp::NEG:
+            ensureCached();
+            emit("D=-D");
+            break;
+        case VMOp::NOT:
+            ensureCached();
+            emit("D=!D");
+            break;
+        case VMOp::LABEL:
+            flush();
+            label(functionName + "$" + instruction.name);
+            break;
+        case VMOp::GOTO:
+            flush();
+            emit("@" + functionName + "$" + instruction.name);
+            emit("0;JMP");
+            break;
+        case VMOp::IF_GOTO:
+            ensureCached();
+            emit("@" + functionName + "$" + instruction.name);
+            emit("D;JNE");
+            cached = false;
+            break;
+        case VMOp::CALL:
+            writeCall(instruction.name, instruction.index);
+            break;
+        case VMOp::RETURN:
+            ensureCached();
+            emit("@$RETURN");
+            emit("0;JMP");
+            cached = false;
+            break;
+        default:
+            throw std::runtime_error("Unexpected command in " + functionName);
+        }
+    }
+}
+
+// $CALL: R13 - адрес возврата, R14 - функция, D - число аргументов
+// $RETURN: D - возвращаемое значение; вызывающий получает его в D, SP = ARG
+void HackWriter::writeRuntime() {
+    label("$CALL");
+    emit("@R15");
+    emit("M=D");
+    emit("@R13");
+    emit("D=M");
+    for (const char* saved : { "", "LCL", "ARG", "THIS", "THAT" }) {
+        if (*saved != '\0') {
+            emit(std::string("@") + saved);
+            emit("D=M");
+        }
+        emit("@SP");
+        emit("AM=M+1");
+        emit("A=A-1");
+        emit("M=D");
+    }
+    emit("@SP");
+    emit("D=M");
+    emit("@LCL");
+    emit("M=D");
+    emit("@R15");
+    emit("D=D-M");
+    emit("@5");
+    emit("D=D-A");
+    emit("@ARG");
+    emit("M=D");
+    emit("@R14");
+    emit("A=M");
+    emit("0;JMP");
+
+    label("$RETURN");
+    emit("@R13");
+    emit("M=D");
+    emit("@LCL");
+    emit("D=M");
+    emit("@5");
+    emit("A=D-A");
+    emit("D=M");
+    emit("@R14");
+    emit("M=D");
+    emit("@ARG");
+    emit("D=M");
+    emit("@SP");
+    emit("M=D");
+    for (const char* restored : { "THAT", "THIS", "ARG", "LCL" }) {
+        emit("@LCL");
+        emit("AM=M-1");
+        emit("D=M");
+        emit(std::string("@") + restored);
+        emit("M=D");
+    }
+    emit("@R13");
+    emit("D=M");
+    emit("@R14");
+    emit("A=M");
+    emit("0;JMP");
+}
+
+void writeHackProgram(std::ostream& out, const std::vector<VMFunction>& functions,
+    size_t* instructionCount, std::vector<std::string>* undefinedFunctions) {
+    bool hasSysInit = false;
+    for (const auto& function : functions) {
+        if (function.name == "Sys.init") hasSysInit = true;
+    }
+
+    HackWriter writer(out);
+    writer.writeBootstrap(hasSysInit ? "Sys.init" : "Main.main");
+    writer.writeRuntime();
+    for (const auto& function : functions) {
+        writer.writeFunction(function);
+    }
+
+    if (instructionCount != nullptr) *instructionCount = writer.instructionCount();
+    if (undefinedFunctions != nullptr) *undefinedFunctions = writer.undefinedFunctions();
+}
@@ -0,0 +1,64 @@
+﻿#pragma once
+#include "VMInstruction.h"
+#include <cstddef>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+// Трансляция команд VM прямо в ассемблер Hack, без промежуточного .vm.
+// Вершина стека по возможности держится в регистре D: push кладёт
+// значение в D, а в память оно уходит только перед следующим push,
+// меткой, переходом или вызовом. Операнд push перед add/sub/and/or/
+// eq/gt/lt берётся прямо из памяти или константы, сравнение перед
+// if-goto становится условным переходом. Вызов и возврат - общие
+// подпрограммы $CALL и $RETURN; возвращённое значение приходит в D.
+class HackWriter {
+public:
+    explicit HackWriter(std::ostream& out);
+
+    // Начальная установка SP и вызов Sys.init (или Main.main, если ОС нет)
+    void writeBootstrap(const std::string& entry);
+
+    // Функция; переменные static принадлежат классу из имени функции
+    void writeFunction(const VMFunction& function);
+
+    // Общие подпрограммы вызова и возврата
+    void writeRuntime();
+
+    // Число команд Hack (размер ROM)
+    size_t instructionCount() const;
+
+    // Вызванные функции, которых не было среди записанных
+    std::vector<std::string> undefinedFunctions() const;
+
+private:
+    void emit(const std::string& instruction);
+    void label(const std::string& name);
+
+    // D <- вершина стека (если она ещё в памяти)
+    void ensureCached();
+    // Вершина из D в память
+    void flush();
+
+    void load(const VMInstruction& push);
+    void store(const VMInstruction& pop);
+    // A <- адрес ячейки сегмента (только если это дёшево); false - нельзя
+    bool address(const VMInstruction& instruction);
+    std::string symbol(const VMInstruction& instruction) const;
+
+    void writeCall(const std::string& name, int nArgs);
+
+    std::ostream& out;
+    size_t instructions = 0;
+    bool cached = false;
+    std::string functionName;
+    std::string className;
+    int labelCounter = 0;
+    std::set<std::string> defined;
+    std::set<std::string> called;
+};
+
+// Программа целиком: загрузчик, функции и подпрограммы вызова
+void writeHackProgram(std::ostream& out, const std::vector<VMFunction>& functions,
+    size_t* instructionCount = nullptr, std::vector<std::string>* undefinedFunctions = nullptr);
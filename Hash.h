@@ -0,0 +1,11 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// 64-битный хеш XXH64 (совместим с эталонной реализацией xxHash)
+uint64_t xxhash64(const void* data, size_t length, uint64_t seed = 0);
+
+inline uint64_t xxhash64(std::string_view text, uint64_t seed = 0) {
+    return xxhash64(text.data(), text.size(), seed);
+}
@@ -0,0 +1,337 @@
+﻿#include "IncrementalCompiler.h"
+#include "CodeGenerator.h"
+#include "Parser.h"
+#include "VMWriter.h"
+#include <algorithm>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+bool isSubroutineKeyword(Keyword keyword) {
+    return keyword == Keyword::CONSTRUCTOR || keyword == Keyword::FUNCTION || keyword == Keyword::METHOD;
+}
+
+bool sameDeclaration(const SymbolTable::MethodInfo& a, const SymbolTable::MethodInfo& b) {
+    return a.name == b.name && a.returnType == b.returnType && a.purity == b.purity &&
+        a.kind == b.kind && a.arity == b.arity;
+}
+
+size_t shift(size_t position, ptrdiff_t delta) {
+    return static_cast<size_t>(static_cast<ptrdiff_t>(position) + delta);
+}
+
+}
+
+IncrementalCompiler::IncrementalCompiler(std::string name, const CompilerOptions& o, const SymbolTable* p)
+    : fileName(std::move(name)), options(o), project(p) {
+}
+
+void IncrementalCompiler::compile(std::string source) {
+    text = std::move(source);
+    compileAll();
+}
+
+void IncrementalCompiler::update(std::string source) {
+    size_t limit = std::min(text.size(), source.size());
+    size_t prefix = 0;
+    while (prefix < limit && text[prefix] == source[prefix]) prefix++;
+    size_t suffix = 0;
+    while (suffix < limit - prefix &&
+        text[text.size() - 1 - suffix] == source[source.size() - 1 - suffix]) {
+        suffix++;
+    }
+    if (valid && prefix == text.size() && text.size() == source.size()) {
+        compiledCount = 0;
+        return;
+    }
+    edit(prefix, text.size() - prefix - suffix,
+        std::string_view(source).substr(prefix, source.size() - prefix - suffix));
+}
+
+void IncrementalCompiler::edit(size_t offset, size_t removed, std::string_view inserted) {
+    if (offset > text.size() || removed > text.size() - offset) {
+        throw std::out_of_range("Edit is outside of the source");
+    }
+    text.replace(offset, removed, inserted);
+    if (!valid) {
+        compileAll();
+        return;
+    }
+
+    // Правка должна лежать внутри одной подпрограммы, не задевая её первый и последний токен
+    size_t index = subroutines.size();
+    for (size_t i = 0; i < subroutines.size(); i++) {
+        const Subroutine& subroutine = subroutines[i];
+        if (tokens[subroutine.firstToken].end <= offset &&
+            offset + removed <= tokens[subroutine.lastToken].offset) {
+            index = i;
+            break;
+        }
+    }
+    if (index == subroutines.size() || !relex(index, offset, removed, inserted.size())) {
+        compileAll();
+        return;
+    }
+
+    valid = false;
+    compiledCount = 0;
+    SymbolTable::MethodInfo before = subroutines[index].declaration;
+    compileSubroutine(index);
+
+    // Следующие подпрограммы видели прежнее объявление
+    if (!sameDeclaration(before, subroutines[index].declaration)) {
+        for (size_t i = index + 1; i < subroutines.size(); i++) {
+            compileSubroutine(i);
+        }
+    }
+    valid = true;
+}
+
+// Разбирает заново токены подпрограммы начиная с правки, пока очередной
+// токен не совпадёт с прежним (дальше текст тот же). Текст уже изменён.
+bool IncrementalCompiler::relex(size_t index, size_t offset, size_t removed, size_t inserted) {
+    Subroutine& subroutine = subroutines[index];
+    ptrdiff_t delta = static_cast<ptrdiff_t>(inserted) - static_cast<ptrdiff_t>(removed);
+    size_t removedEnd = offset + removed;
+    size_t insertedEnd = offset + inserted;
+
+    // Первый токен, который могла задеть правка (и предыдущий: они могли слиться)
+    auto touched = std::lower_bound(tokens.begin() + subroutine.firstToken,
+        tokens.begin() + subroutine.lastToken, offset,
+        [](const Token& token, size_t position) { return token.end < position; });
+    size_t first = static_cast<size_t>(touched - tokens.begin());
+    if (first > subroutine.firstToken) first--;
+
+    size_t start = tokens[first].offset;
+    size_t limit = shift(tokens[subroutine.lastToken].end, delta);
+    JackTokenizer tokenizer(fileName, text.substr(start, limit - start));
+    tokenizer.seek(0, tokens[first].line);
+
+    std::vector<Token> fresh;
+    size_t old = first;
+    for (;;) {
+        tokenizer.advance();
+        if (tokenizer.tokenType() == TokenType::UNKNOWN) return false;
+
+        Token token = {
+            tokenizer.tokenType(),
+            tokenizer.tokenType() == TokenType::SYMBOL ? tokenizer.symbol()[0] : '\0',
+            tokenizer.tokenType() == TokenType::KEYWORD ? tokenizer.keyWord() : Keyword::CLASS,
+            start + tokenizer.tokenOffset(),
+            start + tokenizer.tokenEnd(),
+            tokenizer.tokenLine()
+        };
+        if (token.offset >= insertedEnd) {
+            while (old <= subroutine.lastToken &&
+                (tokens[old].offset < removedEnd || shift(tokens[old].offset, delta) < token.offset)) {
+                old++;
+            }
+            if (old <= subroutine.lastToken && shift(tokens[old].offset, delta) == token.offset) {
+                // Совпал с прежним токеном old: остальные только сдвигаются
+                ptrdiff_t lineDelta = static_cast<ptrdiff_t>(token.line) - static_cast<ptrdiff_t>(tokens[old].line);
+                for (size_t i = old; i < tokens.size(); i++) {
+                    tokens[i].offset = shift(tokens[i].offset, delta);
+                    tokens[i].end = shift(tokens[i].end, delta);
+                    tokens[i].line = shift(tokens[i].line, lineDelta);
+                }
+                ptrdiff_t tokenDelta = static_cast<ptrdiff_t>(fresh.size()) - static_cast<ptrdiff_t>(old - first);
+                tokens.erase(tokens.begin() + first, tokens.begin() + old);
+                tokens.insert(tokens.begin() + first, fresh.begin(), fresh.end());
+
+                subroutine.lastToken = shift(subroutine.lastToken, tokenDelta);
+                for (size_t i = index + 1; i < subroutines.size(); i++) {
+                    subroutines[i].firstToken = shift(subroutines[i].firstToken, tokenDelta);
+                    subroutines[i].lastToken = shift(subroutines[i].lastToken, tokenDelta);
+                }
+                return isSubroutineBody(subroutine.firstToken, subroutine.lastToken);
+            }
+        }
+        fresh.push_back(token);
+    }
+}
+
+void IncrementalCompiler::lex(std::string_view source, size_t offset, size_t line, std::vector<Token>& out) const {
+    JackTokenizer tokenizer(fileName, std::string(source));
+    tokenizer.seek(0, line);
+    for (;;) {
+        tokenizer.advance();
+        if (tokenizer.tokenType() == TokenType::UNKNOWN) break;
+        out.push_back({
+            tokenizer.tokenType(),
+            tokenizer.tokenType() == TokenType::SYMBOL ? tokenizer.symbol()[0] : '\0',
+            tokenizer.tokenType() == TokenType::KEYWORD ? tokenizer.keyWord() : Keyword::CLASS,
+            offset + tokenizer.tokenOffset(),
+            offset + tokenizer.tokenEnd(),
+            tokenizer.tokenLine()
+        });
+    }
+}
+
+// Подпрограммы - от ключевого слова на уровне класса до закрывающей } тела
+bool IncrementalCompiler::findSubroutines(std::vector<Subroutine>& result) const {
+    int depth = 0;
+    size_t start = tokens.size();
+    for (size_t i = 0; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        if (token.type == TokenType::KEYWORD && depth == 1 && start == tokens.size() &&
+            isSubroutineKeyword(token.keyword)) {
+            start = i;
+        }
+        else if (token.type == TokenType::SYMBOL && token.symbol == '{') {
+            depth++;
+        }
+        else if (token.type == TokenType::SYMBOL && token.symbol == '}') {
+            depth--;
+            if (depth < 0) return false;
+            if (depth == 1 && start != tokens.size()) {
+                result.push_back({ start, i });
+                start = tokens.size();
+            }
+        }
+    }
+    return depth == 0 && start == tokens.size();
+}
+
+// Токены [first, last] по-прежнему составляют одну подпрограмму
+bool IncrementalCompiler::isSubroutineBody(size_t first, size_t last) const {
+    if (tokens[first].type != TokenType::KEYWORD || !isSubroutineKeyword(tokens[first].keyword)) {
+        return false;
+    }
+    int depth = 1;
+    for (size_t i = first + 1; i <= last; i++) {
+        const Token& token = tokens[i];
+        if (token.type != TokenType::SYMBOL) continue;
+        if (token.symbol == '{') depth++;
+        if (token.symbol == '}') {
+            depth--;
+            if (depth <= 1 && i != last) return false;
+        }
+    }
+    return depth == 1;
+}
+
+void IncrementalCompiler::compileAll() {
+    valid = false;
+    compiledCount = 0;
+    tokens.clear();
+    subroutines.clear();
+    lex(text, 0, 1, tokens);
+
+    if (!findSubroutines(subroutines)) {
+        // Разбор целиком даёт понятное сообщение об ошибке
+        arena.reset();
+        JackTokenizer tokenizer(fileName, text);
+        Parser parser(tokenizer, arena, options.maxNestingDepth);
+        parser.parseClass();
+        throw std::runtime_error("Unbalanced braces in " + fileName);
+    }
+
+    size_t bodyStart = subroutines.empty() ? tokens.size() : subroutines.front().firstToken;
+    size_t bodyEnd = subroutines.empty() ? tokens.size() - 1 : subroutines.back().lastToken + 1;
+    if (tokens.empty() || bodyEnd != tokens.size() - 1) {
+        throw std::runtime_error("Expected '}' at the end of class in " + fileName);
+    }
+    parseHeader(bodyStart < tokens.size() ? tokens[bodyStart].offset : tokens.back().offset);
+
+    for (size_t i = 0; i < subroutines.size(); i++) {
+        compileSubroutine(i);
+    }
+    valid = true;
+}
+
+// class имя { переменные класса } - до первой подпрограммы
+void IncrementalCompiler::parseHeader(size_t end) {
+    headerArena.reset();
+    classVariables.clear();
+
+    JackTokenizer tokenizer(fileName, text.substr(0, end));
+    tokenizer.setDebugMode(options.debugOutput);
+    Parser parser(tokenizer, headerArena, options.maxNestingDepth);
+    parser.setDebugMode(options.debugOutput);
+
+    parser.consumeKeyword(Keyword::CLASS);
+    className = std::string(parser.consumeIdentifier());
+    parser.consumeSymbol("{");
+    while (parser.atKeyword(Keyword::STATIC) || parser.atKeyword(Keyword::FIELD)) {
+        parser.parseClassVarDec(classVariables);
+    }
+    if (tokenizer.tokenType() != TokenType::UNKNOWN) {
+        throw std::runtime_error("Invalid subroutine type");
+    }
+}
+
+void IncrementalCompiler::compileSubroutine(size_t index) {
+    Subroutine& subroutine = subroutines[index];
+    size_t begin = tokens[subroutine.firstToken].offset;
+    size_t end = tokens[subroutine.lastToken].end;
+
+    arena.reset();
+    JackTokenizer tokenizer(fileName, text.substr(begin, end - begin));
+    tokenizer.setDebugMode(options.debugOutput);
+    tokenizer.seek(0, tokens[subroutine.firstToken].line);
+    Parser parser(tokenizer, arena, options.maxNestingDepth);
+    parser.setDebugMode(options.debugOutput);
+    SubroutineDec* declaration = parser.parseSubroutine();
+
+    // Та же таблица, что при компиляции всего файла к началу этой подпрограммы
+    SymbolTable symbolTable;
+    symbolTable.setProjectTable(project);
+    std::vector<SymbolTable::MethodInfo> previous;
+    for (size_t i = 0; i < index; i++) {
+        previous.push_back(subroutines[i].declaration);
+    }
+    symbolTable.importMethods(previous);
+
+    std::ostringstream out;
+    VMWriter vmWriter(out);
+    vmWriter.setDebugMode(options.debugOutput);
+    CodeGenerator generator(vmWriter, symbolTable, className, options);
+    generator.defineVariables(classVariables);
+    generator.generateSubroutine(*declaration);
+    vmWriter.close();
+
+    subroutine.vm = out.str();
+    std::string name = className + "." + std::string(declaration->name);
+    for (auto& method : symbolTable.methods()) {
+        if (method.name == name) subroutine.declaration = std::move(method);
+    }
+    subroutine.queries = symbolTable.projectQueries();
+    compiledCount++;
+}
+
+std::string IncrementalCompiler::vm() const {
+    std::string result;
+    for (const auto& subroutine : subroutines) {
+        result += subroutine.vm;
+    }
+    return result;
+}
+
+void IncrementalCompiler::writeVm(std::ostream& out) const {
+    for (const auto& subroutine : subroutines) {
+        out << subroutine.vm;
+    }
+}
+
+SymbolTable::FileSummary IncrementalCompiler::summary() const {
+    SymbolTable::FileSummary result;
+    for (const auto& subroutine : subroutines) {
+        result.methods.push_back(subroutine.declaration);
+        result.queries.insert(subroutine.queries.begin(), subroutine.queries.end());
+    }
+    std::sort(result.methods.begin(), result.methods.end(),
+        [](const auto& a, const auto& b) { return a.name < b.name; });
+    return result;
+}
+
+int IncrementalCompiler::fieldCount() const {
+    return static_cast<int>(std::count_if(classVariables.begin(), classVariables.end(),
+        [](const VariableDec& variable) { return variable.kind == VarKind::FIELD; }));
+}
+
+int IncrementalCompiler::staticCount() const {
+    return static_cast<int>(std::count_if(classVariables.begin(), classVariables.end(),
+        [](const VariableDec& variable) { return variable.kind == VarKind::STATIC; }));
+}
@@ -0,0 +1,91 @@
+﻿#pragma once
+#include "Arena.h"
+#include "Ast.h"
+#include "CompilerOptions.h"
+#include "JackTokenizer.h"
+#include "SymbolTable.h"
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Инкрементальная компиляция одного файла (для редактора). Хранит токены
+// и границы подпрограмм; после правки заново разбирает только изменённый
+// участок, компилирует только затронутую подпрограмму (и следующие за ней,
+// если изменилось её объявление) и подставляет её код на место прежнего.
+// Код подпрограммы совпадает с результатом полной компиляции: она
+// компилируется с теми же переменными класса и объявлениями предыдущих
+// подпрограмм, а метки нумеруются заново в каждой функции.
+class IncrementalCompiler {
+public:
+    IncrementalCompiler(std::string fileName, const CompilerOptions& options,
+        const SymbolTable* project = nullptr);
+
+    // Полная компиляция
+    void compile(std::string source);
+
+    // Правка: removed байт начиная с offset заменены на inserted
+    void edit(size_t offset, size_t removed, std::string_view inserted);
+
+    // Новый текст целиком; правка находится по общему началу и концу
+    void update(std::string source);
+
+    const std::string& source() const { return text; }
+    std::string vm() const;
+    void writeVm(std::ostream& out) const;
+
+    // Объявления подпрограмм и запросы к таблице проекта
+    SymbolTable::FileSummary summary() const;
+    int fieldCount() const;
+    int staticCount() const;
+
+    size_t tokenCount() const { return tokens.size(); }
+    size_t subroutineCount() const { return subroutines.size(); }
+    // Подпрограммы, скомпилированные последним вызовом
+    size_t lastCompiled() const { return compiledCount; }
+
+private:
+    struct Token {
+        TokenType type;
+        char symbol;            // Первый символ для SYMBOL
+        Keyword keyword;
+        size_t offset;
+        size_t end;
+        size_t line;
+    };
+
+    struct Subroutine {
+        size_t firstToken;      // Ключевое слово constructor/function/method
+        size_t lastToken;       // Закрывающая }
+        std::string vm;
+        SymbolTable::MethodInfo declaration;
+        std::map<std::string, std::string> queries;
+    };
+
+    void compileAll();
+    void compileSubroutine(size_t index);
+    void parseHeader(size_t end);
+    void lex(std::string_view source, size_t offset, size_t line, std::vector<Token>& out) const;
+    bool findSubroutines(std::vector<Subroutine>& result) const;
+    bool isSubroutineBody(size_t first, size_t last) const;
+    bool relex(size_t index, size_t offset, size_t removed, size_t inserted);
+
+    std::string fileName;
+    CompilerOptions options;
+    const SymbolTable* project;
+
+    std::string text;
+    std::vector<Token> tokens;
+    std::vector<Subroutine> subroutines;
+    bool valid = false;             // Последняя компиляция прошла без ошибок
+    size_t compiledCount = 0;
+
+    // Имя и переменные класса живут до следующей полной компиляции
+    Arena headerArena;
+    std::string className;
+    std::vector<VariableDec> classVariables;
+
+    // Дерево одной подпрограммы
+    Arena arena;
+};
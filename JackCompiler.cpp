@@ -0,0 +1,84 @@
+﻿#include "JackCompiler.h"
+#include "CompilationEngine.h"
+#include <sstream>
+#include <stdexcept>
+
+void compileClass(JackTokenizer& tokenizer, VMWriter& vmWriter, SymbolTable& symbolTable,
+    const std::string& className, const CompilerOptions& options, Arena& arena) {
+    if (options.buildSyntaxTree) {
+        Parser parser(tokenizer, arena, options.maxNestingDepth);
+        parser.setDebugMode(options.debugOutput);
+        ClassDec* classDec = parser.parseClass();
+        CodeGenerator generator(vmWriter, symbolTable, className, options);
+        generator.generateClass(*classDec);
+        arena.reset();
+    }
+    else {
+        CompilationEngine compiler(
+            tokenizer,
+            vmWriter,
+            symbolTable,
+            className,
+            options
+        );
+        compiler.compileClass();
+    }
+    vmWriter.close();
+}
+
+CompilationResult compileJack(std::span<const JackSource> sources,
+    const CompilerOptions& options, VMOutput output) {
+    CompilerWorkspace workspace;
+    return compileJack(sources, workspace, options, output);
+}
+
+CompilationResult compileJack(std::span<const JackSource> sources, CompilerWorkspace& workspace,
+    const CompilerOptions& options, VMOutput output) {
+    CompilationResult result;
+    Arena& arena = workspace.arena;
+    SymbolTable projectTable;
+
+    for (const auto& source : sources) {
+        std::string name(source.name);
+        JackTokenizer tokenizer(name, std::string(source.text));
+        tokenizer.setDebugMode(options.debugOutput);
+        SymbolTable symbolTable;
+        symbolTable.setProjectTable(&projectTable);
+
+        CompiledClass compiled;
+        compiled.name = name;
+        try {
+            std::vector<VMFunction> functions;
+            VMWriter vmWriter(functions);
+            vmWriter.setDebugMode(options.debugOutput);
+            compileClass(tokenizer, vmWriter, symbolTable, name, options, arena);
+            compiled.counters = vmWriter.counterSites();
+
+            if (output != VMOutput::INSTRUCTIONS) {
+                std::ostringstream text;
+                for (const auto& function : functions) {
+                    writeFunctionText(text, function);
+                }
+                compiled.vm = text.str();
+            }
+            if (output != VMOutput::TEXT) {
+                compiled.functions = std::move(functions);
+            }
+        }
+        catch (const std::exception& e) {
+            arena.reset();
+            result.diagnostics.push_back({ name, tokenizer.tokenLine(), e.what() });
+            continue;
+        }
+
+        symbolTable.exportMethods(projectTable);
+        result.classes.push_back(std::move(compiled));
+    }
+    return result;
+}
+
+CompilationResult compileJack(std::string_view name, std::string_view text,
+    const CompilerOptions& options, VMOutput output) {
+    JackSource source{ name, text };
+    return compileJack(std::span<const JackSource>(&source, 1), options, output);
+}
@@ -0,0 +1,62 @@
+﻿#pragma once
+#include "Arena.h"
+#include "CompilerOptions.h"
+#include "JackTokenizer.h"
+#include "SymbolTable.h"
+#include "VMInstruction.h"
+#include "VMWriter.h"
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Компиляция из памяти, без файловой системы: исходники на входе,
+// VM-код и сообщения об ошибках на выходе. Функции не используют общего
+// изменяемого состояния, поэтому их можно вызывать из нескольких потоков.
+
+struct JackSource {
+    std::string_view name;      // Имя класса (имя файла без .jack)
+    std::string_view text;
+};
+
+struct Diagnostic {
+    std::string source;
+    size_t line = 0;            // 0 - строка неизвестна
+    std::string message;
+};
+
+struct CompiledClass {
+    std::string name;
+    std::string vm;                     // Текст .vm (VMOutput::TEXT, BOTH)
+    std::vector<VMFunction> functions;  // Буфер команд (VMOutput::INSTRUCTIONS, BOTH)
+    std::vector<std::string> counters;  // Места счётчиков Profile.count (options.instrument)
+};
+
+enum class VMOutput { TEXT, INSTRUCTIONS, BOTH };
+
+struct CompilationResult {
+    std::vector<CompiledClass> classes;     // Успешно скомпилированные классы
+    std::vector<Diagnostic> diagnostics;
+
+    bool succeeded() const { return diagnostics.empty(); }
+};
+
+// Память, которую поток может использовать повторно между вызовами
+struct CompilerWorkspace {
+    Arena arena;
+};
+
+// Компилирует классы по порядку; каждый видит объявления предыдущих.
+// Ошибка в одном классе не мешает компиляции остальных.
+CompilationResult compileJack(std::span<const JackSource> sources,
+    const CompilerOptions& options = CompilerOptions(), VMOutput output = VMOutput::TEXT);
+
+CompilationResult compileJack(std::span<const JackSource> sources, CompilerWorkspace& workspace,
+    const CompilerOptions& options = CompilerOptions(), VMOutput output = VMOutput::TEXT);
+
+CompilationResult compileJack(std::string_view name, std::string_view text,
+    const CompilerOptions& options = CompilerOptions(), VMOutput output = VMOutput::TEXT);
+
+// Компилирует класс однопроходно или через дерево (options.buildSyntaxTree)
+void compileClass(JackTokenizer& tokenizer, VMWriter& vmWriter, SymbolTable& symbolTable,
+    const std::string& className, const CompilerOptions& options, Arena& arena);
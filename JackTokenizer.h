@@ -1,5 +1,6 @@
-#pragma once
-#include <fstream>
+﻿#pragma once
+#include "CompileStatistics.h"
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -19,6 +20,8 @@ std::string keywordToString(Keyword keyword);
 class JackTokenizer {
 public:
     explicit JackTokenizer(const std::string& filename);
+    // Исходник уже прочитан в память, имя файла нужно только для сообщений
+    JackTokenizer(const std::string& filename, std::string source);
     ~JackTokenizer();
 
     bool hasMoreTokens() const;
@@ -26,12 +29,23 @@ public:
     void getCurrentTokenInfo() const;
     TokenType tokenType() const;
     Keyword keyWord() const;
-    std::string symbol() const;
-    std::string identifier() const;
+    const std::string& symbol() const;
+    const std::string& identifier() const;
     int intVal() const;
-    std::string stringVal() const;
+    const std::string& stringVal() const;
     void setDebugMode(bool mode);
 
+    // Счётчик токенов и время лексера (nullptr - не собирать)
+    void setStatistics(FileStatistics* statistics);
+
+    // Положение текущего токена в исходнике: [tokenOffset, tokenEnd) и строка
+    size_t tokenOffset() const { return currentOffset; }
+    size_t tokenEnd() const { return currentEnd; }
+    size_t tokenLine() const { return currentLine; }
+
+    // Продолжить разбор с позиции offset (начала токена или пробела между токенами)
+    void seek(size_t offset, size_t line);
+
     std::string currentString;
 
     void readString();
@@ -42,17 +56,23 @@ public:
 private:
     void skipCommentsAndWhitespace();
     void readNextToken();
+    void readToken();
     bool isKeyword(const std::string& token) const;
+    size_t position() const;
 
-    std::ifstream input;
+    std::istringstream input;
     TokenType currentType;
     Keyword currentKeyword;
     std::string currentSymbol;
     std::string currentIdentifier;
     int currentInt;
 
-    bool debugMode = true;
+    bool debugMode = false;
+    FileStatistics* statistics = nullptr;
     size_t lineNumber = 1;
+    size_t currentOffset = 0;
+    size_t currentEnd = 0;
+    size_t currentLine = 1;
 
     static const std::unordered_set<char> symbols;
     static const std::unordered_map<std::string, Keyword> keywordMap;
@@ -1,8 +1,12 @@
 ﻿#include "JackTokenizer.h"
+#include "AllocationTracker.h"
 #include <cctype>
 #include <stdexcept>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iterator>
 // Символы языка Jack
 const std::unordered_set<char> JackTokenizer::symbols = {
 	'{', '}', '(', ')', '[', ']', '.', ',', ';', '+',
@@ -24,15 +28,19 @@ const std::unordered_map<std::string, Keyword> JackTokenizer::keywordMap = {
 };
 
 JackTokenizer::JackTokenizer(const std::string& filename)
-	: input(filename), currentType(TokenType::UNKNOWN) {
-	currentSymbol.clear();
-	if (!input.is_open()) {
+	: currentType(TokenType::UNKNOWN) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
 		throw std::runtime_error("Failed to open file: " + filename);
 	}
+	input.str(std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()));
+}
+
+JackTokenizer::JackTokenizer(const std::string& filename, std::string source)
+	: input(std::move(source)), currentType(TokenType::UNKNOWN) {
 }
 
 JackTokenizer::~JackTokenizer() {
-	if (input.is_open()) input.close();
 }
 
 bool JackTokenizer::hasMoreTokens() const {
@@ -42,6 +50,22 @@ bool JackTokenizer::hasMoreTokens() const {
 void JackTokenizer::setDebugMode(bool mode) {
 	debugMode = mode;
 }
+
+void JackTokenizer::setStatistics(FileStatistics* s) {
+	statistics = s;
+}
+
+size_t JackTokenizer::position() const {
+	// Через буфер: tellg() после достижения конца потока возвращает -1
+	return static_cast<size_t>(input.rdbuf()->pubseekoff(0, std::ios::cur, std::ios::in));
+}
+
+void JackTokenizer::seek(size_t offset, size_t line) {
+	input.clear();
+	input.seekg(static_cast<std::streamoff>(offset));
+	lineNumber = line;
+	currentType = TokenType::UNKNOWN;
+}
 void JackTokenizer::readString() {
 	input.get(); 
 	currentString.clear();
@@ -99,6 +123,18 @@ void JackTokenizer::readKeywordOrIdentifier() {
 }
 
 void JackTokenizer::advance() {
+	AllocationScope scope(AllocationPhase::TOKENIZER);
+	if (statistics == nullptr) {
+		readToken();
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+	readToken();
+	statistics->lexSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (currentType != TokenType::UNKNOWN) statistics->tokens++;
+}
+
+void JackTokenizer::readToken() {
 	skipCommentsAndWhitespace();
 	if (input.eof()) {
 		currentType = TokenType::UNKNOWN;
@@ -106,6 +142,8 @@ void JackTokenizer::advance() {
 	}
 
 	size_t tokenLine = lineNumber;
+	currentLine = tokenLine;
+	currentOffset = position();
 	char c = input.peek();
 	
 	if (symbols.count(c)) {
@@ -133,6 +171,8 @@ void JackTokenizer::advance() {
 			"' at line " + std::to_string(tokenLine));
 	}
 
+	currentEnd = position();
+
 	if (debugMode) {
 		getCurrentTokenInfo();
 		std::cout << " (processed at line " << tokenLine << ")" << std::endl;
@@ -325,7 +365,7 @@ void JackTokenizer::getCurrentTokenInfo() const {
 // Геттеры
 TokenType JackTokenizer::tokenType() const { return currentType; }
 Keyword JackTokenizer::keyWord() const { return currentKeyword; }
-std::string JackTokenizer::symbol() const { return currentSymbol; }
-std::string JackTokenizer::identifier() const { return currentIdentifier; }
+const std::string& JackTokenizer::symbol() const { return currentSymbol; }
+const std::string& JackTokenizer::identifier() const { return currentIdentifier; }
 int JackTokenizer::intVal() const { return currentInt; }
-std::string JackTokenizer::stringVal() const { return currentString; }
\ No newline at end of file
+const std::string& JackTokenizer::stringVal() const { return currentString; }
\ No newline at end of file
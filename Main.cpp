@@ -1,84 +1,609 @@
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
 #include <vector>
-#include "JackTokenizer.h"
-#include "CompilationEngine.h"
+#include "BatchBuilder.h"
+#include "AllocationTracker.h"
+#include "CompileStatistics.h"
+#include "CompilerOptions.h"
+#include "CostEstimator.h"
+#include "FileWatcher.h"
+#include "FunctionFolding.h"
+#include "HackWriter.h"
+#include "JackCompiler.h"
+#include "Profile.h"
+#include "ProjectBuilder.h"
+#include "Superinstructions.h"
+#include "VMBundle.h"
+#include "VMBytecode.h"
+#include "VMInterpreter.h"
 
 namespace fs = std::filesystem;
 
-//   .jack   
-std::vector<fs::path> getJackFiles(const fs::path& path) {
+// Получить список файлов с расширением extension (файл или каталог)
+std::vector<fs::path> getFiles(const fs::path& path, const std::string& extension) {
     std::vector<fs::path> files;
 
     if (fs::is_directory(path)) {
         for (const auto& entry : fs::directory_iterator(path)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".jack") {
+            if (entry.is_regular_file() && entry.path().extension() == extension) {
                 files.push_back(entry.path());
             }
         }
     }
-    else if (path.extension() == ".jack") {
+    else if (path.extension() == extension) {
         files.push_back(path);
     }
 
+    // Постоянный порядок: классы видят объявления ранее скомпилированных
+    std::sort(files.begin(), files.end());
     return files;
 }
 
+// Получить список .jack файлов для обработки
+std::vector<fs::path> getJackFiles(const fs::path& path) {
+    return getFiles(path, ".jack");
+}
+
+std::string readFile(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// Преобразование .vm <-> .vmb; результат пишется рядом с исходным файлом
+void convertVmFiles(const fs::path& inputPath, bool toBytecode) {
+    auto files = getFiles(inputPath, toBytecode ? ".vm" : ".vmb");
+    if (files.empty()) {
+        throw std::runtime_error(toBytecode ? "No .vm files found" : "No .vmb files found");
+    }
+    for (const auto& file : files) {
+        fs::path target = file;
+        target.replace_extension(toBytecode ? ".vmb" : ".vm");
+        std::string data = readFile(file);
+        std::ofstream out(target, toBytecode ? std::ios::binary : std::ios::out);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + target.string());
+        }
+        if (toBytecode) {
+            out << encodeBytecode(parseFunctionsText(data));
+        }
+        else {
+            for (const auto& function : decodeBytecode(data)) {
+                writeFunctionText(out, function);
+            }
+        }
+        std::cout << "Converted: " << file.filename() << " -> " << target.filename() << "\n";
+    }
+}
+
+// Понижает суперкоманды в готовых .vm файлах до обычных команд VM
+// (для стандартных транслятора и эмулятора); файлы переписываются на месте
+void lowerVmFiles(const fs::path& inputPath) {
+    auto files = getFiles(inputPath, ".vm");
+    if (files.empty()) {
+        throw std::runtime_error("No .vm files found");
+    }
+    for (const auto& file : files) {
+        std::vector<VMFunction> functions = parseFunctionsText(readFile(file));
+        size_t lowered = 0;
+        for (auto& function : functions) {
+            if (!hasSuperinstructions(function)) continue;
+            lowerSuperinstructions(function);
+            lowered++;
+        }
+        if (lowered == 0) continue;
+
+        std::ofstream out(file);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + file.string());
+        }
+        for (const auto& function : functions) {
+            writeFunctionText(out, function);
+        }
+        std::cout << "Lowered: " << file.filename() << " (" << lowered << " function(s))\n";
+    }
+}
+
+// Исполняет готовые VM-файлы с расширением extension (.vm или .vmb);
+// вывод программы идёт в stdout
+void runVmFiles(const fs::path& inputPath, const std::string& extension, uint64_t maxSteps) {
+    auto files = getFiles(inputPath, extension);
+    if (files.empty()) {
+        throw std::runtime_error("No " + extension + " files found");
+    }
+    VMInterpreter interpreter;
+    for (const auto& file : files) {
+        std::string data = readFile(file);
+        interpreter.load(extension == ".vmb" ? decodeBytecode(data) : parseFunctionsText(data));
+    }
+
+    interpreter.setInstructionLimit(maxSteps);
+    VMInterpreter::Result result = interpreter.run(std::cout, &std::cin);
+    std::cerr << "Executed " << result.instructions << " VM instruction(s) in "
+        << result.seconds * 1000 << " ms ("
+        << result.instructions / std::max(result.seconds, 1e-9) / 1e6 << " M/s)"
+        << (result.halted ? ", halted" : "") << "\n";
+}
+
+// Компилирует все файлы в память (буферы команд); ошибки выводятся в stderr
+bool compileInMemory(const std::vector<fs::path>& jackFiles, const CompilerOptions& options,
+    CompilationResult& result) {
+    std::vector<std::string> names;
+    std::vector<std::string> texts;
+    for (const auto& jackFile : jackFiles) {
+        texts.push_back(readFile(jackFile));
+        names.push_back(jackFile.stem().string());
+    }
+    std::vector<JackSource> sources;
+    for (size_t i = 0; i < jackFiles.size(); i++) {
+        sources.push_back({ names[i], texts[i] });
+    }
+
+    result = compileJack(sources, options, VMOutput::INSTRUCTIONS);
+    for (const auto& diagnostic : result.diagnostics) {
+        std::cerr << "Error: " << diagnostic.source << ".jack";
+        if (diagnostic.line > 0) std::cerr << ":" << diagnostic.line;
+        std::cerr << ": " << diagnostic.message << "\n";
+    }
+    return result.succeeded();
+}
+
+void printFoldStatistics(const FoldStatistics& statistics) {
+    std::cout << "Folded: " << statistics.functions << " identical function(s), "
+        << statistics.instructions << " VM instruction(s) removed\n";
+}
+
+// Компилирует все файлы в память и записывает один связанный бандл;
+// fold - свёртка одинаковых функций при связывании
+bool buildBundle(const std::vector<fs::path>& jackFiles, const fs::path& bundlePath, const CompilerOptions& options,
+    bool fold) {
+    CompilationResult result;
+    if (!compileInMemory(jackFiles, options, result)) {
+        return false;
+    }
+
+    size_t classCount = result.classes.size();
+    std::vector<LinkPass> passes;
+    if (fold) {
+        passes.push_back([](std::vector<CompiledClass>& classes) {
+            printFoldStatistics(foldIdenticalFunctions(classes));
+        });
+    }
+    std::string bundle = linkBundle(std::move(result.classes), passes);
+    writeBundle(bundlePath, bundle);
+    std::cout << "Bundled: " << classCount << " class(es) -> " << bundlePath.string()
+        << " (" << bundle.size() << " bytes)\n";
+    return true;
+}
+
+// Готовые .vm файлы каталога без исходника .jack (например, ОС)
+std::vector<VMFunction> libraryFunctions(const fs::path& inputPath) {
+    std::vector<VMFunction> functions;
+    for (const auto& vmFile : getFiles(inputPath, ".vm")) {
+        fs::path jackFile = vmFile;
+        if (fs::exists(jackFile.replace_extension(".jack"))) continue;
+        for (auto& function : parseFunctionsText(readFile(vmFile))) {
+            functions.push_back(std::move(function));
+        }
+    }
+    return functions;
+}
+
+// Компилирует проект прямо в ассемблер Hack. Готовые .vm файлы каталога
+// без исходника .jack (например, ОС) транслируются вместе с ним.
+bool buildAssembly(const fs::path& inputPath, const std::vector<fs::path>& jackFiles, const fs::path& asmPath,
+    const CompilerOptions& options, bool fold) {
+    CompilationResult result;
+    if (!compileInMemory(jackFiles, options, result)) {
+        return false;
+    }
+
+    std::vector<VMFunction> functions = libraryFunctions(inputPath);
+    for (auto& compiled : result.classes) {
+        for (auto& function : compiled.functions) {
+            functions.push_back(std::move(function));
+        }
+    }
+    if (fold) {
+        printFoldStatistics(foldIdenticalFunctions(functions));
+    }
+
+    std::ofstream out(asmPath);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open output file: " + asmPath.string());
+    }
+    size_t instructionCount = 0;
+    std::vector<std::string> undefined;
+    writeHackProgram(out, functions, &instructionCount, &undefined);
+    if (!out) {
+        throw std::runtime_error("Failed to write output file: " + asmPath.string());
+    }
+
+    for (const auto& name : undefined) {
+        std::cerr << "Warning: " << name << " is not defined (add the OS .vm files to the project)\n";
+    }
+    std::cout << "Assembled: " << functions.size() << " function(s) -> " << asmPath.string()
+        << " (" << instructionCount << " instructions)\n";
+    return true;
+}
+
+// Компилирует проект в память и печатает оценку стоимости в тактах Hack;
+// файлы не записываются
+bool printCosts(const std::vector<fs::path>& jackFiles, const CompilerOptions& options, size_t top) {
+    CompilationResult result;
+    if (!compileInMemory(jackFiles, options, result)) {
+        return false;
+    }
+
+    std::vector<VMFunction> functions;
+    for (auto& compiled : result.classes) {
+        for (auto& function : compiled.functions) {
+            functions.push_back(std::move(function));
+        }
+    }
+    printCostReport(std::cout, estimateCosts(functions), top);
+    return true;
+}
+
+// Компилирует проект со счётчиками (--instrument), исполняет встроенным
+// интерпретатором и записывает число исполнений каждого места в профиль
+bool collectProfile(const fs::path& inputPath, const std::vector<fs::path>& jackFiles, const fs::path& profilePath,
+    CompilerOptions options, uint64_t maxSteps) {
+    options.instrument = true;
+    options.profile = nullptr;
+    CompilationResult result;
+    if (!compileInMemory(jackFiles, options, result)) {
+        return false;
+    }
+
+    VMInterpreter interpreter;
+    interpreter.load(libraryFunctions(inputPath));
+    for (auto& compiled : result.classes) {
+        interpreter.load(std::move(compiled.functions));
+    }
+    interpreter.setInstructionLimit(maxSteps);
+    VMInterpreter::Result run = interpreter.run(std::cout, &std::cin);
+    std::cerr << "Executed " << run.instructions << " VM instruction(s) in " << run.seconds * 1000 << " ms\n";
+
+    Profile profile;
+    auto counts = interpreter.profileCounts();
+    for (const auto& compiled : result.classes) {
+        const std::vector<uint64_t>& classCounts = counts[compiled.name];
+        for (size_t i = 0; i < compiled.counters.size(); i++) {
+            profile.add(compiled.counters[i], i < classCounts.size() ? classCounts[i] : 0);
+        }
+    }
+    profile.save(profilePath);
+    std::cout << "Profile: " << profile.size() << " site(s) -> " << profilePath.string() << "\n";
+    return true;
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <input.jack|directory>\n";
+    CompilerOptions options;
+    std::vector<std::string> positional;
+    std::string cacheDirectory;
+    std::string bundlePath;
+    std::string asmPath;
+    std::string instrumentPath;     // --instrument: куда записать профиль
+    std::string profilePath;        // --profile-use
+    bool costReport = false;
+    bool foldFunctions = false;     // --fold-functions (только --bundle и --asm)
+    size_t costTop = 20;
+    bool useInterfaces = false;
+    bool watch = false;
+    bool batch = false;
+    std::string vmTool;     // --to-text, --to-bytecode, --bench-bytecode, --to-plain
+    bool run = false;
+    std::string statsFormat;    // text или json
+    std::string statsPath;
+    bool allocationStats = false;
+    double allocationBudget = 0;   // Предел выделений на токен (0 - без предела)
+    uint64_t maxSteps = 0;
+    unsigned jobs = std::thread::hardware_concurrency();
+    // Уровень -O задаёт набор проходов, --enable-pass/--disable-pass (и
+    // --no-cse, --no-licm, --no-cfg, --superinstructions) меняют его по порядку
+    std::string optimizationLevel = "O2";
+    std::vector<std::pair<std::string, bool>> passSwitches;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-O0" || arg == "-O1" || arg == "-Os" || arg == "-O2") {
+            optimizationLevel = arg.substr(1);
+        }
+        else if ((arg == "--enable-pass" || arg == "--disable-pass") && i + 1 < argc) {
+            passSwitches.emplace_back(argv[++i], arg == "--enable-pass");
+        }
+        else if (arg == "--no-cse" || arg == "--no-licm" || arg == "--no-cfg") {
+            passSwitches.emplace_back(arg.substr(5), false);
+        }
+        else if (arg == "--dump-after" && i + 1 < argc) {
+            options.dumpAfter = argv[++i];
+        }
+        else if (arg == "--ast") {
+            options.buildSyntaxTree = true;
+        }
+        else if (arg == "--max-depth" && i + 1 < argc) {
+            options.maxNestingDepth = std::stoul(argv[++i]);
+        }
+        else if (arg == "--cache" && i + 1 < argc) {
+            cacheDirectory = argv[++i];
+        }
+        else if (arg == "--interfaces") {
+            useInterfaces = true;
+        }
+        else if (arg == "--watch") {
+            watch = true;
+        }
+        else if (arg == "--debug") {
+            options.debugOutput = true;
+        }
+        else if (arg == "--batch") {
+            batch = true;
+        }
+        else if (arg == "--bundle" && i + 1 < argc) {
+            bundlePath = argv[++i];
+        }
+        else if (arg == "--asm" && i + 1 < argc) {
+            asmPath = argv[++i];
+        }
+        else if (arg == "--superinstructions") {
+            passSwitches.emplace_back("super", true);
+        }
+        else if (arg == "--fold-functions") {
+            foldFunctions = true;
+        }
+        else if (arg == "--bytecode") {
+            options.bytecodeOutput = true;
+        }
+        else if (arg == "--to-text" || arg == "--to-bytecode" || arg == "--bench-bytecode" || arg == "--to-plain") {
+            vmTool = arg;
+        }
+        else if (arg == "--stats" && i + 1 < argc) {
+            statsFormat = argv[++i];
+        }
+        else if (arg == "--stats-output" && i + 1 < argc) {
+            statsPath = argv[++i];
+        }
+        else if (arg == "--alloc-stats") {
+            allocationStats = true;
+        }
+        else if (arg == "--alloc-budget" && i + 1 < argc) {
+            allocationBudget = std::stod(argv[++i]);
+        }
+        else if (arg == "--line-map") {
+            options.lineMap = true;
+        }
+        else if (arg == "--cost-report") {
+            costReport = true;
+        }
+        else if (arg == "--cost-top" && i + 1 < argc) {
+            costTop = std::stoul(argv[++i]);
+        }
+        else if (arg == "--instrument" && i + 1 < argc) {
+            instrumentPath = argv[++i];
+        }
+        else if (arg == "--profile-use" && i + 1 < argc) {
+            profilePath = argv[++i];
+        }
+        else if (arg == "--run") {
+            run = true;
+        }
+        else if (arg == "--max-steps" && i + 1 < argc) {
+            maxSteps = std::stoull(argv[++i]);
+        }
+        else if (arg == "--jobs" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else {
+            positional.push_back(arg);
+        }
+    }
+
+    if (positional.size() != 1) {
+        std::cerr << "Usage: " << argv[0] << " [-O0|-O1|-Os|-O2] [--enable-pass P] [--disable-pass P] [--dump-after P|all] [--no-cse] [--no-licm] [--no-cfg] [--ast] [--max-depth N] [--cache DIR] [--interfaces] [--watch] [--debug] [--batch [--jobs N]] [--bundle out.vm] [--asm out.asm] [--fold-functions] [--bytecode] [--superinstructions] [--run [--max-steps N]] [--stats text|json [--stats-output FILE]] [--alloc-stats] [--alloc-budget N] [--instrument PROFILE] [--profile-use PROFILE] [--line-map] [--cost-report [--cost-top N]] <input.jack|directory|manifest>\n"
+            << "       " << argv[0] << " --to-text|--to-bytecode|--bench-bytecode|--to-plain <file|directory>\n";
         return 1;
     }
 
-    const fs::path inputPath(argv[1]);
+    const fs::path inputPath(positional[0]);
 
     try {
-        //   
+        // Проверка существования пути
         if (!fs::exists(inputPath)) {
             throw std::runtime_error("Path does not exist: " + inputPath.string());
         }
 
-        //     
-        auto jackFiles = getJackFiles(inputPath);
-        if (jackFiles.empty()) {
-            throw std::runtime_error("No .jack files found");
+        if (!options.setOptimizationLevel(optimizationLevel)) {
+            throw std::runtime_error("Unknown optimization level: " + optimizationLevel);
+        }
+        for (const auto& [pass, enabled] : passSwitches) {
+            if (!options.setPassEnabled(pass, enabled)) {
+                throw std::runtime_error("Unknown optimization pass: " + pass);
+            }
+        }
+        if (!options.dumpAfter.empty() && options.dumpAfter != "all" &&
+            std::find(std::begin(PASS_NAMES), std::end(PASS_NAMES), options.dumpAfter) == std::end(PASS_NAMES)) {
+            throw std::runtime_error("Unknown optimization pass: " + options.dumpAfter);
+        }
+        if (!statsFormat.empty() && statsFormat != "text" && statsFormat != "json") {
+            throw std::runtime_error("Unknown --stats format: " + statsFormat);
+        }
+        if (!instrumentPath.empty() && (batch || watch || run || options.bytecodeOutput ||
+            !bundlePath.empty() || !asmPath.empty())) {
+            throw std::runtime_error("--instrument cannot be combined with --batch, --watch, --run, --bytecode, --bundle or --asm");
+        }
+        // Пул строк нумерует статические по таблице класса, а --watch
+        // компилирует каждую подпрограмму с отдельной таблицей
+        if (!profilePath.empty() && watch) {
+            throw std::runtime_error("--profile-use cannot be combined with --watch");
+        }
+        if (costReport && (batch || watch || run || options.bytecodeOutput || options.lineMap ||
+            !instrumentPath.empty() || !bundlePath.empty() || !asmPath.empty())) {
+            throw std::runtime_error("--cost-report cannot be combined with --batch, --watch, --run, --bytecode, --line-map, --instrument, --bundle or --asm");
+        }
+        if (options.lineMap && (batch || watch || !instrumentPath.empty() || !bundlePath.empty() || !asmPath.empty())) {
+            throw std::runtime_error("--line-map cannot be combined with --batch, --watch, --instrument, --bundle or --asm");
+        }
+        if (!profilePath.empty()) {
+            options.profile = std::make_shared<const Profile>(Profile::load(profilePath));
         }
 
-        //   
-        for (const auto& jackFile : jackFiles) {
-            //   
-            fs::path vmPath = jackFile;
-            vmPath.replace_extension(".vm");
+        bool trackAllocations = allocationStats || allocationBudget > 0;
+        if (trackAllocations && !AllocationTracker::available()) {
+            throw std::runtime_error("--alloc-stats and --alloc-budget require a build with JACKC_TRACK_ALLOCATIONS");
+        }
+        if (trackAllocations && (batch || watch)) {
+            throw std::runtime_error("--alloc-stats and --alloc-budget cannot be combined with --batch or --watch");
+        }
+        if (run && (batch || watch)) {
+            throw std::runtime_error("--run cannot be combined with --batch or --watch");
+        }
+        if ((!bundlePath.empty() || !asmPath.empty()) && (batch || watch || options.bytecodeOutput)) {
+            throw std::runtime_error("--bundle and --asm cannot be combined with --batch, --watch or --bytecode");
+        }
+        if (foldFunctions && bundlePath.empty() && asmPath.empty()) {
+            throw std::runtime_error("--fold-functions requires --bundle or --asm");
+        }
+        if (!asmPath.empty() && (run || !bundlePath.empty())) {
+            throw std::runtime_error("--asm cannot be combined with --run or --bundle");
+        }
 
-            std::cout << "Compiling file: " << jackFile.filename() << "\n";
+        // Инструменты для готового VM-кода
+        if (vmTool == "--bench-bytecode") {
+            std::vector<std::string> texts;
+            for (const auto& file : getFiles(inputPath, ".vm")) {
+                texts.push_back(readFile(file));
+            }
+            if (texts.empty()) {
+                throw std::runtime_error("No .vm files found");
+            }
+            benchmarkBytecode(texts, std::cout);
+            return 0;
+        }
+        if (vmTool == "--to-plain") {
+            lowerVmFiles(inputPath);
+            return 0;
+        }
+        if (!vmTool.empty()) {
+            convertVmFiles(inputPath, vmTool == "--to-bytecode");
+            return 0;
+        }
 
-            //   
-            JackTokenizer tokenizer(jackFile.string());
-            VMWriter vmWriter(vmPath.string());
-            SymbolTable symbolTable;
+        // Пакетный режим: каждый каталог с .jack файлами (или из манифеста) - проект
+        if (batch) {
+            auto projects = fs::is_directory(inputPath)
+                ? BatchBuilder::findProjects(inputPath)
+                : BatchBuilder::readManifest(inputPath);
+            BatchBuilder builder(options, jobs);
+            BatchBuilder::Statistics statistics = builder.run(projects, std::cout);
+            BatchBuilder::printStatistics(statistics, std::cout);
+            return statistics.failedProjects == 0 && statistics.failedWrites == 0 ? 0 : 1;
+        }
 
-            //      
-            std::string className = jackFile.stem().string();
+        // Получаем список файлов для обработки
+        auto jackFiles = getJackFiles(inputPath);
+        if (run && jackFiles.empty()) {
+            bool bytecode = inputPath.extension() == ".vmb" ||
+                (fs::is_directory(inputPath) && getFiles(inputPath, ".vm").empty());
+            runVmFiles(inputPath, bytecode ? ".vmb" : ".vm", maxSteps);
+            return 0;
+        }
+        if (jackFiles.empty()) {
+            throw std::runtime_error("No .jack files found");
+        }
 
-            // 
-            CompilationEngine compiler(
-                tokenizer,
-                vmWriter,
-                symbolTable,
-                className
-            );
-            std::string cmd = "call  Math.divide  2";
-            std::string funcName = cmd.substr(5, cmd.find(' ') - 5);
-            std::string argsStr = cmd.substr(cmd.find_last_of(' ') + 1);
-            
-            compiler.compileClass();
-            vmWriter.close();
+        if (costReport) {
+            return printCosts(jackFiles, options, costTop) ? 0 : 1;
+        }
+        if (!instrumentPath.empty()) {
+            return collectProfile(inputPath, jackFiles, instrumentPath, options, maxSteps) ? 0 : 1;
+        }
+        if (!asmPath.empty()) {
+            return buildAssembly(inputPath, jackFiles, asmPath, options, foldFunctions) ? 0 : 1;
+        }
+        if (!bundlePath.empty()) {
+            if (!buildBundle(jackFiles, bundlePath, options, foldFunctions)) return 1;
+            if (run) runVmFiles(bundlePath, ".vm", maxSteps);
+            return 0;
+        }
 
-            std::cout << "Compiled: "
-                << jackFile.filename() << " -> "
-                << vmPath.filename() << "\n";
+        ProjectBuilder builder(options, cacheDirectory, useInterfaces);
+        if (!watch) {
+            CompileStatistics statistics;
+            // Число токенов для выделений на токен берётся из тех же счётчиков
+            if (!statsFormat.empty() || trackAllocations) builder.setCompileStatistics(&statistics);
+            if (trackAllocations) AllocationTracker::reset();
+            auto start = std::chrono::steady_clock::now();
+            builder.build(jackFiles);
+            statistics.setWallTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+            builder.printStatistics(std::cout);
+            if (!statsFormat.empty()) {
+                std::ofstream statsFile;
+                if (!statsPath.empty()) {
+                    statsFile.open(statsPath);
+                    if (!statsFile.is_open()) {
+                        throw std::runtime_error("Failed to open output file: " + statsPath);
+                    }
+                }
+                std::ostream& out = statsPath.empty() ? std::cout : statsFile;
+                if (statsFormat == "json") statistics.printJson(out);
+                else statistics.printText(out);
+            }
+            if (trackAllocations) {
+                size_t tokens = statistics.tokenCount();
+                double perToken = AllocationTracker::allocationsPerToken(tokens);
+                AllocationTracker::printReport(std::cout, tokens);
+                if (allocationBudget > 0 && perToken > allocationBudget) {
+                    std::cerr << "Allocation budget exceeded: " << perToken << " allocations per token (budget "
+                        << allocationBudget << ")\n";
+                    return 1;
+                }
+            }
+            if (run) {
+                std::string extension = options.bytecodeOutput ? ".vmb" : ".vm";
+                fs::path vmPath = inputPath;
+                runVmFiles(fs::is_directory(inputPath) ? inputPath : vmPath.replace_extension(extension),
+                    extension, maxSteps);
+            }
+            return 0;
         }
 
+        // Процесс остаётся запущенным: таблица проекта, арена и хеши
+        // файлов сохраняются, пересобираются только изменённые файлы.
+        // После ошибки следующая сборка снова проходит по всем файлам.
+        FileWatcher watcher(inputPath);
+        builder.setIncremental(true);
+        bool complete = false;
+        FileWatcher::Changes changes;
+        for (;;) {
+            auto start = std::chrono::steady_clock::now();
+            try {
+                if (!complete) {
+                    builder.build(getJackFiles(inputPath));
+                    builder.printStatistics(std::cout);
+                    complete = true;
+                }
+                else {
+                    size_t compiled = builder.update(changes.changed, changes.removed);
+                    auto elapsed = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+                    std::cout << "Rebuilt " << compiled << " file(s) in " << elapsed << " ms\n";
+                }
+            }
+            catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << "\n";
+                complete = false;
+            }
+            std::cout << "Watching " << inputPath << " for changes...\n" << std::flush;
+            changes = watcher.wait();
+        }
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << "\n";
@@ -0,0 +1,306 @@
+﻿#include "Optimizer.h"
+#include "ControlFlowGraph.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace {
+
+// Цикл: метка начала и обратный переход на неё
+struct Loop {
+    size_t header = 0;
+    size_t backEdge = 0;
+};
+
+// Что меняется внутри цикла
+struct LoopEffects {
+    std::unordered_set<int> locals;
+    std::unordered_set<int> arguments;
+    bool writesMemory = false;      // this/that/static или вызов с побочными эффектами
+    bool writesThisPointer = false;
+};
+
+// Значение на стеке VM, которое вычисляют команды [start, end]
+struct StackValue {
+    size_t start;
+    size_t end;
+    bool invariant;
+    bool computed;                  // Есть операция или вызов, а не один push
+};
+
+bool isJump(const VMInstruction& instruction) {
+    return instruction.op == VMOp::GOTO || instruction.op == VMOp::IF_GOTO;
+}
+
+// Находит цикл по метке начала: обратный goto на неё и никаких входов извне
+bool findLoop(const std::vector<VMInstruction>& body, const std::string& label, Loop& loop) {
+    bool hasHeader = false;
+    bool hasBackEdge = false;
+    for (size_t i = 0; i < body.size(); i++) {
+        if (body[i].op == VMOp::LABEL && body[i].name == label) {
+            loop.header = i;
+            hasHeader = true;
+        }
+        else if (hasHeader && body[i].op == VMOp::GOTO && body[i].name == label) {
+            loop.backEdge = i;
+            hasBackEdge = true;
+        }
+    }
+    if (!hasBackEdge) return false;
+
+    std::unordered_set<std::string> innerLabels;
+    for (size_t i = loop.header; i <= loop.backEdge; i++) {
+        if (body[i].op == VMOp::LABEL) innerLabels.insert(body[i].name);
+    }
+    for (size_t i = 0; i < body.size(); i++) {
+        bool outside = i < loop.header || i > loop.backEdge;
+        if (outside && isJump(body[i]) && innerLabels.count(body[i].name)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Сбор определений переменных и записей в память внутри цикла
+LoopEffects analyzeLoop(const std::vector<VMInstruction>& body, const Loop& loop,
+    const SymbolTable& symbolTable) {
+    LoopEffects effects;
+    for (size_t i = loop.header; i <= loop.backEdge; i++) {
+        const VMInstruction& instruction = body[i];
+        if (instruction.op == VMOp::POP) {
+            switch (instruction.segment) {
+            case Segment::LOCAL:    effects.locals.insert(instruction.index); break;
+            case Segment::ARGUMENT: effects.arguments.insert(instruction.index); break;
+            case Segment::THIS:
+            case Segment::THAT:
+            case Segment::STATIC:   effects.writesMemory = true; break;
+            case Segment::POINTER:
+                if (instruction.index == 0) effects.writesThisPointer = true;
+                break;
+            default: break;
+            }
+        }
+        else if (instruction.op == VMOp::CALL &&
+            symbolTable.getMethodPurity(instruction.name) == Purity::IMPURE) {
+            effects.writesMemory = true;
+        }
+    }
+    return effects;
+}
+
+// Начало кода цикла, который выполняется не на каждой итерации или после
+// побочных эффектов: первая метка, переход или вызов IMPURE после метки начала.
+// Вычисление до этого места (условие цикла) выполняется при каждом входе в
+// цикл, поэтому вызов, который может завершиться ошибкой, можно вынести
+// только оттуда.
+size_t findGuardedStart(const std::vector<VMInstruction>& body, const Loop& loop,
+    const SymbolTable& symbolTable) {
+    for (size_t i = loop.header + 1; i < loop.backEdge; i++) {
+        const VMInstruction& instruction = body[i];
+        if (instruction.op == VMOp::LABEL || isJump(instruction) || instruction.op == VMOp::RETURN ||
+            (instruction.op == VMOp::CALL && symbolTable.getMethodPurity(instruction.name) == Purity::IMPURE)) {
+            return i;
+        }
+    }
+    return loop.backEdge;
+}
+
+// Максимальные инвариантные подвыражения цикла (диапазоны команд)
+std::vector<std::pair<size_t, size_t>> findInvariants(const std::vector<VMInstruction>& body,
+    const Loop& loop, const LoopEffects& effects, const SymbolTable& symbolTable) {
+    std::vector<std::pair<size_t, size_t>> invariants;
+    std::vector<StackValue> stack;
+
+    auto consume = [&](const StackValue& value) {
+        if (value.invariant && value.computed) {
+            invariants.emplace_back(value.start, value.end);
+        }
+    };
+    // Операция над n верхними значениями стека
+    auto apply = [&](size_t index, size_t n, bool invariantOp) {
+        if (stack.size() < n) {
+            stack.clear();
+            stack.push_back({ index, index, false, true });
+            return;
+        }
+        size_t first = stack.size() - n;
+        bool invariant = invariantOp;
+        for (size_t i = first; i < stack.size(); i++) {
+            invariant = invariant && stack[i].invariant;
+        }
+        size_t start = (n > 0) ? stack[first].start : index;
+        if (!invariant) {
+            for (size_t i = first; i < stack.size(); i++) consume(stack[i]);
+        }
+        stack.resize(first);
+        stack.push_back({ start, index, invariant, true });
+    };
+
+    bool hasAddress = false;
+    StackValue address{};
+    size_t guardedStart = findGuardedStart(body, loop, symbolTable);
+
+    for (size_t i = loop.header + 1; i < loop.backEdge; i++) {
+        const VMInstruction& instruction = body[i];
+
+        switch (instruction.op) {
+        case VMOp::PUSH: {
+            bool invariant = false;
+            switch (instruction.segment) {
+            case Segment::CONSTANT: invariant = true; break;
+            case Segment::LOCAL:    invariant = !effects.locals.count(instruction.index); break;
+            case Segment::ARGUMENT: invariant = !effects.arguments.count(instruction.index); break;
+            case Segment::THIS:
+            case Segment::STATIC:   invariant = !effects.writesMemory; break;
+            case Segment::POINTER:
+                invariant = instruction.index == 0 && !effects.writesThisPointer;
+                break;
+            case Segment::THAT:
+                // Чтение элемента массива: адрес, pop pointer 1, push that 0
+                if (hasAddress) {
+                    stack.push_back({ address.start, i,
+                        address.invariant && !effects.writesMemory, true });
+                    hasAddress = false;
+                    continue;
+                }
+                break;
+            default: break;
+            }
+            stack.push_back({ i, i, invariant, false });
+            break;
+        }
+
+        case VMOp::POP:
+            if (stack.empty()) break;
+            if (instruction.segment == Segment::POINTER && instruction.index == 1 &&
+                i + 1 < loop.backEdge && body[i + 1].op == VMOp::PUSH &&
+                body[i + 1].segment == Segment::THAT) {
+                address = stack.back();
+                hasAddress = true;
+                stack.pop_back();
+                if (!address.invariant || effects.writesMemory) consume(address);
+                break;
+            }
+            consume(stack.back());
+            stack.pop_back();
+            break;
+
+        case VMOp::NEG:
+        case VMOp::NOT:
+            apply(i, 1, true);
+            break;
+
+        case VMOp::CALL: {
+            Purity purity = symbolTable.getMethodPurity(instruction.name);
+            bool invariant = !(mayFail(purity) && i >= guardedStart);
+            purity = withoutFailure(purity);
+            invariant = invariant && (purity == Purity::PURE ||
+                    (purity == Purity::READS_MEMORY && !effects.writesMemory));
+            apply(i, static_cast<size_t>(instruction.index), invariant);
+            break;
+        }
+
+        case VMOp::IF_GOTO:
+        case VMOp::RETURN:
+            if (!stack.empty()) consume(stack.back());
+            stack.clear();
+            break;
+
+        case VMOp::NOP:
+            break;
+
+        default:
+            if (isArithmetic(instruction.op)) {
+                apply(i, 2, true);
+            }
+            else {
+                stack.clear();
+            }
+        }
+    }
+    return invariants;
+}
+
+// Переносит вычисления в блок перед меткой цикла
+int hoist(VMFunction& function, const Loop& loop,
+    const std::vector<std::pair<size_t, size_t>>& invariants) {
+    std::vector<VMInstruction>& body = function.body;
+    std::vector<std::vector<VMInstruction>> hoisted;
+    std::vector<int> hoistedLocals;
+    std::vector<int> localOf(invariants.size());
+
+    // Одинаковые вычисления получают одну локальную переменную
+    for (size_t i = 0; i < invariants.size(); i++) {
+        std::vector<VMInstruction> code(body.begin() + invariants[i].first,
+            body.begin() + invariants[i].second + 1);
+        size_t existing = 0;
+        while (existing < hoisted.size() && hoisted[existing] != code) existing++;
+        if (existing == hoisted.size()) {
+            hoisted.push_back(std::move(code));
+            hoistedLocals.push_back(function.nLocals++);
+        }
+        localOf[i] = hoistedLocals[existing];
+    }
+
+    std::vector<VMInstruction> result(body.begin(), body.begin() + loop.header);
+    for (size_t i = 0; i < hoisted.size(); i++) {
+        result.insert(result.end(), hoisted[i].begin(), hoisted[i].end());
+        result.push_back({ VMOp::POP, Segment::LOCAL, hoistedLocals[i] });
+    }
+
+    size_t next = 0;
+    for (size_t i = loop.header; i < body.size(); i++) {
+        if (next < invariants.size() && i == invariants[next].first) {
+            result.push_back({ VMOp::PUSH, Segment::LOCAL, localOf[next] });
+            i = invariants[next].second;
+            next++;
+            continue;
+        }
+        result.push_back(std::move(body[i]));
+    }
+    body.swap(result);
+    return static_cast<int>(hoisted.size());
+}
+
+}
+
+int hoistLoopInvariants(VMFunction& function, const SymbolTable& symbolTable) {
+    // Метки начала циклов в порядке появления: внешние циклы раньше вложенных
+    std::unordered_set<std::string> seenLabels;
+    std::unordered_set<std::string> backEdgeTargets;
+    for (const auto& instruction : function.body) {
+        if (instruction.op == VMOp::LABEL) {
+            seenLabels.insert(instruction.name);
+        }
+        else if (instruction.op == VMOp::GOTO && seenLabels.count(instruction.name)) {
+            backEdgeTargets.insert(instruction.name);
+        }
+    }
+    std::vector<std::string> headers;
+    for (const auto& instruction : function.body) {
+        if (instruction.op == VMOp::LABEL && backEdgeTargets.count(instruction.name)) {
+            headers.push_back(instruction.name);
+        }
+    }
+
+    int hoisted = 0;
+    for (const auto& header : headers) {
+        Loop loop;
+        if (!findLoop(function.body, header, loop)) continue;
+
+        LoopEffects effects = analyzeLoop(function.body, loop, symbolTable);
+        auto invariants = findInvariants(function.body, loop, effects, symbolTable);
+        if (!invariants.empty()) {
+            std::sort(invariants.begin(), invariants.end());
+            hoisted += hoist(function, loop, invariants);
+        }
+    }
+    return hoisted;
+}
+
+void optimizeControlFlow(VMFunction& function) {
+    ControlFlowGraph graph(function);
+    graph.threadJumps();
+    graph.duplicateLoopConditions();
+    graph.layout();
+    graph.emit(function);
+}
@@ -0,0 +1,10 @@
+﻿#pragma once
+#include "VMInstruction.h"
+#include "SymbolTable.h"
+
+// Выносит вычисления, не меняющиеся в цикле while, в блок перед меткой начала цикла.
+// Возвращает число вынесенных выражений.
+int hoistLoopInvariants(VMFunction& function, const SymbolTable& symbolTable);
+
+// Строит граф потока управления, убирает переходы на переходы и лишние метки
+void optimizeControlFlow(VMFunction& function);
@@ -0,0 +1,374 @@
+﻿#include "OutputWriter.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define JACKC_IO_URING 1
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+#ifdef JACKC_IO_URING
+
+// Кольца io_uring через системные вызовы, без liburing
+class OutputWriter::Ring {
+public:
+    ~Ring() {
+        // Ядро может ещё читать буферы отложенных пачек
+        std::vector<io_uring_cqe> completions;
+        drain(completions);
+        if (sqes != nullptr) munmap(sqes, sqesSize);
+        if (cqRing != nullptr && cqRing != sqRing) munmap(cqRing, cqRingSize);
+        if (sqRing != nullptr) munmap(sqRing, sqRingSize);
+        if (fd >= 0) close(fd);
+    }
+
+    bool open(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) return false;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+
+        sqRing = mmap(nullptr, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqRing == MAP_FAILED) { sqRing = nullptr; return false; }
+        cqRing = single ? sqRing
+            : mmap(nullptr, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (cqRing == MAP_FAILED) { cqRing = nullptr; return false; }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqesMap = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqesMap == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe*>(sqesMap);
+
+        char* sq = static_cast<char*>(sqRing);
+        char* cq = static_cast<char*>(cqRing);
+        sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sqMask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cqMask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        capacity = params.sq_entries;
+
+        return supports({ IORING_OP_OPENAT, IORING_OP_WRITE, IORING_OP_CLOSE });
+    }
+
+    unsigned size() const { return capacity; }
+
+    // Следующая запись очереди отправки (не больше size() за один run)
+    io_uring_sqe& next(uint64_t userData) {
+        unsigned tail = *sqTail + pending;
+        unsigned index = tail & sqMask;
+        io_uring_sqe& sqe = sqes[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.user_data = userData;
+        sqArray[index] = index;
+        pending++;
+        return sqe;
+    }
+
+    // Отправляет подготовленные записи и ждёт все их завершения. При ошибке
+    // io_uring_enter неотправленные записи отменяются, а отправленные
+    // дожидаются завершения; их результаты тоже попадают в completions.
+    bool run(std::vector<io_uring_cqe>& completions) {
+        unsigned count = pending;
+        unsigned start = *sqTail;
+        __atomic_store_n(sqTail, start + pending, __ATOMIC_RELEASE);
+        pending = 0;
+
+        completions.clear();
+        unsigned submitted = 0;
+        while (completions.size() < count) {
+            unsigned toSubmit = count - submitted;
+            unsigned wait = count - static_cast<unsigned>(completions.size());
+            long result = syscall(__NR_io_uring_enter, fd, toSubmit, wait, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result < 0) {
+                if (errno == EINTR) continue;
+                // Без SQPOLL ядро берёт записи только в io_uring_enter
+                __atomic_store_n(sqTail, start + submitted, __ATOMIC_RELEASE);
+                inFlight = submitted - static_cast<unsigned>(completions.size());
+                drain(completions);
+                return false;
+            }
+            submitted += static_cast<unsigned>(result);
+            reap(completions);
+        }
+        return true;
+    }
+
+    // Отправленные, но не завершённые операции: их буферы трогать нельзя
+    bool busy() const { return inFlight > 0; }
+
+    // Держит пачку, пока ядро может читать её пути и данные
+    void retain(std::vector<Job> batch) { retained.push_back(std::move(batch)); }
+
+private:
+    void reap(std::vector<io_uring_cqe>& completions) {
+        unsigned head = *cqHead;
+        unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            completions.push_back(cqes[head & cqMask]);
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    // Ждёт завершения отправленных операций; false - ядро не отвечает
+    bool drain(std::vector<io_uring_cqe>& completions) {
+        while (inFlight > 0) {
+            size_t before = completions.size();
+            long result = syscall(__NR_io_uring_enter, fd, 0, inFlight, IORING_ENTER_GETEVENTS, nullptr, 0);
+            if (result < 0 && errno != EINTR) return false;
+            reap(completions);
+            inFlight -= std::min(inFlight, static_cast<unsigned>(completions.size() - before));
+        }
+        return true;
+    }
+
+    bool supports(std::initializer_list<int> operations) {
+        constexpr unsigned OPERATION_COUNT = 256;
+        std::vector<char> buffer(sizeof(io_uring_probe) + OPERATION_COUNT * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(buffer.data());
+        if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, OPERATION_COUNT) < 0) {
+            return false;
+        }
+        for (int operation : operations) {
+            if (operation > probe->last_op || !(probe->ops[operation].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int fd = -1;
+    void* sqRing = nullptr;
+    void* cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    unsigned* sqTail = nullptr;
+    unsigned* sqArray = nullptr;
+    unsigned sqMask = 0;
+    unsigned* cqHead = nullptr;
+    unsigned* cqTail = nullptr;
+    unsigned cqMask = 0;
+    io_uring_cqe* cqes = nullptr;
+    unsigned capacity = 0;
+    unsigned pending = 0;
+    unsigned inFlight = 0;
+    std::vector<std::vector<Job>> retained;
+};
+
+#else
+
+class OutputWriter::Ring {
+public:
+    bool open(unsigned) { return false; }
+};
+
+#endif
+
+OutputWriter::OutputWriter(Backend backend, unsigned threadCount) {
+    if (backend == Backend::AUTO) {
+        ring = std::make_unique<Ring>();
+        if (ring->open(64)) {
+            threads.emplace_back(&OutputWriter::runRing, this);
+            return;
+        }
+        ring.reset();
+    }
+    for (unsigned i = 0; i < std::max(1u, threadCount); i++) {
+        threads.emplace_back(&OutputWriter::runThread, this);
+    }
+}
+
+OutputWriter::~OutputWriter() {
+    finish();
+}
+
+const char* OutputWriter::backendName() const {
+    return ring ? "io_uring" : "threads";
+}
+
+void OutputWriter::submit(fs::path path, std::string data) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back({ std::move(path), std::move(data) });
+    }
+    ready.notify_one();
+}
+
+std::vector<std::string> OutputWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    ready.notify_all();
+    for (auto& thread : threads) {
+        if (thread.joinable()) thread.join();
+    }
+    threads.clear();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return std::move(errors);
+}
+
+bool OutputWriter::takeBatch(std::vector<Job>& batch, size_t limit) {
+    batch.clear();
+    std::unique_lock<std::mutex> lock(mutex);
+    ready.wait(lock, [this] { return closed || !queue.empty(); });
+    while (!queue.empty() && batch.size() < limit) {
+        batch.push_back(std::move(queue.front()));
+        queue.pop_front();
+    }
+    return !batch.empty();
+}
+
+void OutputWriter::fail(std::string message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    errors.push_back(std::move(message));
+}
+
+void OutputWriter::writeFile(const Job& job) {
+    std::ofstream out(job.path, std::ios::binary);
+    out.write(job.data.data(), static_cast<std::streamsize>(job.data.size()));
+    if (!out) fail("Failed to write output file: " + job.path.string());
+}
+
+void OutputWriter::runThread() {
+    std::vector<Job> batch;
+    while (takeBatch(batch, 1)) {
+        for (const auto& job : batch) {
+            writeFile(job);
+        }
+    }
+}
+
+void OutputWriter::runRing() {
+#ifdef JACKC_IO_URING
+    std::vector<Job> batch;
+    bool usable = true;
+    while (takeBatch(batch, ring->size())) {
+        if (usable && writeBatch(batch)) continue;
+
+        // io_uring_enter не сработал: пачка пишется обычным способом. Если
+        // отправленные операции не удалось дождаться, ядро может ещё читать
+        // буферы пачки - они остаются у кольца, и оно больше не используется.
+        if (ring->busy()) {
+            usable = false;
+            std::vector<Job> copy = batch;
+            ring->retain(std::move(batch));
+            batch = std::move(copy);
+        }
+        for (const auto& job : batch) {
+            writeFile(job);
+        }
+    }
+#endif
+}
+
+bool OutputWriter::writeBatch(const std::vector<Job>& batch) {
+#ifdef JACKC_IO_URING
+    std::vector<io_uring_cqe> completions;
+    std::vector<std::string> batchErrors;
+    size_t count = batch.size();
+    std::vector<int> descriptors(count, -1);
+    std::vector<size_t> written(count, 0);
+
+    // Закрывает открытые файлы пачки, когда её нужно переписать целиком
+    auto abandon = [&]() {
+        if (ring->busy()) return false;
+        for (int descriptor : descriptors) {
+            if (descriptor >= 0) close(descriptor);
+        }
+        return false;
+    };
+
+    // Открытие всех файлов пачки
+    for (size_t i = 0; i < count; i++) {
+        io_uring_sqe& sqe = ring->next(i);
+        sqe.opcode = IORING_OP_OPENAT;
+        sqe.fd = AT_FDCWD;
+        sqe.addr = reinterpret_cast<uint64_t>(batch[i].path.c_str());
+        sqe.open_flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+        sqe.len = 0644;
+    }
+    bool submitted = ring->run(completions);
+    for (const auto& completion : completions) {
+        if (completion.res >= 0) {
+            descriptors[completion.user_data] = completion.res;
+        }
+        else {
+            batchErrors.push_back("Failed to open output file: " + batch[completion.user_data].path.string() +
+                ": " + std::strerror(-completion.res));
+        }
+    }
+    if (!submitted) return abandon();
+
+    // Запись; неполная запись продолжается в следующем круге
+    for (;;) {
+        size_t queued = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (descriptors[i] < 0 || written[i] >= batch[i].data.size()) continue;
+            io_uring_sqe& sqe = ring->next(i);
+            sqe.opcode = IORING_OP_WRITE;
+            sqe.fd = descriptors[i];
+            sqe.addr = reinterpret_cast<uint64_t>(batch[i].data.data() + written[i]);
+            sqe.len = static_cast<uint32_t>(std::min<size_t>(batch[i].data.size() - written[i], 1u << 30));
+            sqe.off = written[i];
+            queued++;
+        }
+        if (queued == 0) break;
+        if (!ring->run(completions)) return abandon();
+        for (const auto& completion : completions) {
+            size_t i = completion.user_data;
+            if (completion.res > 0) {
+                written[i] += static_cast<size_t>(completion.res);
+                continue;
+            }
+            batchErrors.push_back("Failed to write output file: " + batch[i].path.string() +
+                (completion.res < 0 ? std::string(": ") + std::strerror(-completion.res) : std::string()));
+            written[i] = batch[i].data.size();
+        }
+    }
+
+    // Закрытие; данные уже записаны, поэтому при сбое кольца файлы,
+    // о закрытии которых ядро не сообщило, закрываются здесь
+    size_t open = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (descriptors[i] < 0) continue;
+        io_uring_sqe& sqe = ring->next(i);
+        sqe.opcode = IORING_OP_CLOSE;
+        sqe.fd = descriptors[i];
+        open++;
+    }
+    if (open > 0 && !ring->run(completions) && !ring->busy()) {
+        for (const auto& completion : completions) {
+            descriptors[completion.user_data] = -1;
+        }
+        for (int descriptor : descriptors) {
+            if (descriptor >= 0) close(descriptor);
+        }
+    }
+    for (auto& message : batchErrors) {
+        fail(std::move(message));
+    }
+    return true;
+#else
+    return false;
+#endif
+}
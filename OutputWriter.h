@@ -0,0 +1,60 @@
+﻿#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Асинхронная запись готовых выходных файлов. Потоки компиляции только
+// ставят буфер в очередь и не ждут диска. В Linux записи отправляются
+// пачками через io_uring (открытие, запись и закрытие - по одному
+// системному вызову на пачку), иначе их выполняет небольшой пул потоков.
+class OutputWriter {
+public:
+    enum class Backend { AUTO, THREADS };
+
+    explicit OutputWriter(Backend backend = Backend::AUTO, unsigned threads = 2);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    // Поставить файл в очередь на запись
+    void submit(std::filesystem::path path, std::string data);
+
+    // Дождаться записи всех файлов и остановить потоки. Возвращает ошибки.
+    std::vector<std::string> finish();
+
+    // "io_uring" или "threads"
+    const char* backendName() const;
+
+private:
+    struct Job {
+        std::filesystem::path path;
+        std::string data;
+    };
+    class Ring;
+
+    // Забирает до limit заданий; false, если очередь закрыта и пуста
+    bool takeBatch(std::vector<Job>& batch, size_t limit);
+    void runThread();
+    void runRing();
+    // Пишет пачку через io_uring; false - кольцо дало сбой, файлы пачки
+    // нужно записать заново
+    bool writeBatch(const std::vector<Job>& batch);
+    void writeFile(const Job& job);
+    void fail(std::string message);
+
+    std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Job> queue;
+    bool closed = false;
+    std::vector<std::string> errors;
+
+    std::unique_ptr<Ring> ring;
+    std::vector<std::thread> threads;
+};
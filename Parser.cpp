@@ -0,0 +1,621 @@
+﻿#include "Parser.h"
+#include <iostream>
+#include <stdexcept>
+#include <unordered_set>
+
+Parser::Parser(JackTokenizer& t, Arena& a, size_t depth)
+    : tokenizer(t), arena(a), maxDepth(depth) {
+    tokenizer.advance();
+}
+
+// class имя { переменные класса подпрограммы }
+ClassDec* Parser::parseClass() {
+    ClassDec* classDec = arena.make<ClassDec>();
+
+    consumeKeyword(Keyword::CLASS);
+    classDec->name = consumeIdentifier();
+    consumeSymbol("{");
+
+    std::vector<VariableDec> variables;
+    while (atKeyword(Keyword::STATIC) || atKeyword(Keyword::FIELD)) {
+        parseClassVarDec(variables);
+    }
+    classDec->variables = arena.copy(variables);
+
+    std::vector<SubroutineDec*> subroutines;
+    while (atKeyword(Keyword::CONSTRUCTOR) || atKeyword(Keyword::FUNCTION) ||
+        atKeyword(Keyword::METHOD)) {
+        subroutines.push_back(parseSubroutine());
+    }
+    classDec->subroutines = arena.copy(subroutines);
+
+    consumeSymbol("}");
+    return classDec;
+}
+
+// (static | field) тип имя (, имя)* ;
+void Parser::parseClassVarDec(std::vector<VariableDec>& variables) {
+    VarKind kind;
+    if (atKeyword(Keyword::STATIC)) kind = VarKind::STATIC;
+    else if (atKeyword(Keyword::FIELD)) kind = VarKind::FIELD;
+    else throw std::runtime_error("Invalid class variable");
+    eat();
+
+    std::string_view type = parseType();
+    while (true) {
+        variables.push_back({ kind, type, consumeIdentifier() });
+        if (!atSymbol(",")) break;
+        eat();
+    }
+    consumeSymbol(";");
+}
+
+SubroutineDec* Parser::parseSubroutine() {
+    SubroutineDec* subroutine = parseSubroutineSignature();
+
+    consumeSymbol("{");
+    std::vector<VariableDec> locals;
+    while (atKeyword(Keyword::VAR)) {
+        parseVarDec(locals);
+    }
+    subroutine->locals = arena.copy(locals);
+    subroutine->body = parseStatements();
+    consumeSymbol("}");
+    return subroutine;
+}
+
+SubroutineDec* Parser::parseSubroutineSignature() {
+    SubroutineDec* subroutine = arena.make<SubroutineDec>();
+    subroutine->line = tokenizer.tokenLine();
+
+    if (!atKeyword(Keyword::CONSTRUCTOR) && !atKeyword(Keyword::FUNCTION) &&
+        !atKeyword(Keyword::METHOD)) {
+        throw std::runtime_error("Invalid subroutine type");
+    }
+    subroutine->kind = tokenizer.keyWord();
+    eat();
+
+    if (atKeyword(Keyword::VOID)) {
+        subroutine->returnType = "void";
+        eat();
+    }
+    else {
+        subroutine->returnType = parseType();
+    }
+    subroutine->name = consumeIdentifier();
+
+    consumeSymbol("(");
+    subroutine->parameters = parseParameterList();
+    consumeSymbol(")");
+    return subroutine;
+}
+
+std::span<VariableDec> Parser::parseParameterList() {
+    std::vector<VariableDec> parameters;
+    if (atSymbol(")")) {
+        return {}; // Пустой список параметров
+    }
+
+    while (true) {
+        std::string_view type;
+        if (tokenizer.tokenType() == TokenType::KEYWORD) {
+            if (tokenizer.keyWord() != Keyword::INT &&
+                tokenizer.keyWord() != Keyword::CHAR &&
+                tokenizer.keyWord() != Keyword::BOOLEAN) {
+                throw std::runtime_error("Invalid parameter type");
+            }
+            type = parseType();
+        }
+        else if (tokenizer.tokenType() == TokenType::IDENTIFIER) {
+            type = parseType();
+        }
+        else {
+            throw std::runtime_error("Expected parameter type");
+        }
+        if (tokenizer.tokenType() != TokenType::IDENTIFIER) {
+            throw std::runtime_error("Expected parameter name");
+        }
+        parameters.push_back({ VarKind::ARG, type, consumeIdentifier() });
+
+        if (!atSymbol(",")) break;
+        eat();
+    }
+    return arena.copy(parameters);
+}
+
+// var тип имя (, имя)* ;
+void Parser::parseVarDec(std::vector<VariableDec>& locals) {
+    consumeKeyword(Keyword::VAR);
+    std::string_view type = parseType();
+    while (true) {
+        locals.push_back({ VarKind::VAR, type, consumeIdentifier() });
+        if (!atSymbol(",")) break;
+        eat();
+    }
+    consumeSymbol(";");
+}
+
+std::span<Statement*> Parser::parseStatements() {
+    std::vector<Block> blocks(1);
+    parseBlocks(blocks, false);
+    return arena.copy(blocks[0].statements);
+}
+
+// Операторы до конца уровня blocks[0]. Вложенные if/while открывают блок
+// в стеке blocks вместо рекурсивного вызова.
+void Parser::parseBlocks(std::vector<Block>& blocks, bool singleStatement) {
+    while (true) {
+        Block& block = blocks.back();
+        if (atKeyword(Keyword::LET)) {
+            block.statements.push_back(parseLet());
+        }
+        else if (atKeyword(Keyword::DO)) {
+            block.statements.push_back(parseDo());
+        }
+        else if (atKeyword(Keyword::RETURN)) {
+            block.statements.push_back(parseReturn());
+        }
+        else if (atKeyword(Keyword::IF) || atKeyword(Keyword::WHILE)) {
+            Statement* statement = atKeyword(Keyword::IF) ? parseIfHeader() : parseWhileHeader();
+            block.statements.push_back(statement);
+            openBlock(blocks, statement);
+        }
+        else if (blocks.size() > 1) {
+            closeBlock(blocks);
+            if (singleStatement && blocks.size() == 1) return;
+        }
+        else {
+            return;
+        }
+    }
+}
+
+void Parser::openBlock(std::vector<Block>& blocks, Statement* owner) {
+    if (blocks.size() > maxDepth) {
+        throw std::runtime_error("Statement nesting exceeds the limit of " + std::to_string(maxDepth));
+    }
+    blocks.emplace_back();
+    blocks.back().owner = owner;
+}
+
+// '}' закрывает блок; после ветви then может начаться ветвь else
+void Parser::closeBlock(std::vector<Block>& blocks) {
+    consumeSymbol("}");
+    Block block = std::move(blocks.back());
+    blocks.pop_back();
+
+    Statement* owner = block.owner;
+    if (block.inElse) {
+        owner->elseBody = arena.copy(block.statements);
+        return;
+    }
+    owner->body = arena.copy(block.statements);
+    if (owner->kind == StatementKind::IF && parseElse()) {
+        blocks.emplace_back();
+        blocks.back().owner = owner;
+        blocks.back().inElse = true;
+    }
+}
+
+Statement* Parser::parseLet() {
+    Statement* statement = arena.make<Statement>();
+    statement->kind = StatementKind::LET;
+    statement->line = tokenizer.tokenLine();
+
+    consumeKeyword(Keyword::LET);
+    statement->name = consumeIdentifier();
+    if (atSymbol("[")) {
+        eat();
+        statement->index = parseExpression();
+        consumeSymbol("]");
+    }
+    consumeSymbol("=");
+    statement->value = parseExpression();
+    consumeSymbol(";");
+    return statement;
+}
+
+Statement* Parser::parseIf() {
+    std::vector<Block> blocks(1);
+    Statement* statement = parseIfHeader();
+    openBlock(blocks, statement);
+    parseBlocks(blocks, true);
+    return statement;
+}
+
+Statement* Parser::parseWhile() {
+    std::vector<Block> blocks(1);
+    Statement* statement = parseWhileHeader();
+    openBlock(blocks, statement);
+    parseBlocks(blocks, true);
+    return statement;
+}
+
+Statement* Parser::parseIfHeader() {
+    Statement* statement = arena.make<Statement>();
+    statement->kind = StatementKind::IF;
+    statement->line = tokenizer.tokenLine();
+
+    consumeKeyword(Keyword::IF);
+    consumeSymbol("(");
+    statement->value = parseExpression();
+    consumeSymbol(")");
+    consumeSymbol("{");
+    return statement;
+}
+
+Statement* Parser::parseWhileHeader() {
+    Statement* statement = arena.make<Statement>();
+    statement->kind = StatementKind::WHILE;
+    statement->line = tokenizer.tokenLine();
+
+    consumeKeyword(Keyword::WHILE);
+    consumeSymbol("(");
+    statement->value = parseExpression();
+    consumeSymbol(")");
+    consumeSymbol("{");
+    return statement;
+}
+
+bool Parser::parseElse() {
+    if (!atKeyword(Keyword::ELSE)) return false;
+    eat();
+    consumeSymbol("{");
+    return true;
+}
+
+Statement* Parser::parseDo() {
+    Statement* statement = arena.make<Statement>();
+    statement->kind = StatementKind::DO;
+    statement->line = tokenizer.tokenLine();
+
+    consumeKeyword(Keyword::DO);
+    std::string_view identifier = consumeIdentifier();
+    statement->value = parseSubroutineCall(identifier);
+    consumeSymbol(";");
+    return statement;
+}
+
+Statement* Parser::parseReturn() {
+    Statement* statement = arena.make<Statement>();
+    statement->kind = StatementKind::RETURN;
+    statement->line = tokenizer.tokenLine();
+
+    consumeKeyword(Keyword::RETURN);
+    if (!atSymbol(";")) {
+        statement->value = parseExpression();
+    }
+    consumeSymbol(";");
+    return statement;
+}
+
+// Разбор выражения: term (op term)*, операторы Jack без приоритетов
+Expr* Parser::parseExpression() {
+    return parseOperators(false);
+}
+
+Expr* Parser::parseTerm() {
+    return parseOperators(true);
+}
+
+// Разбор выражения без рекурсии: стек операндов и стек операторов, в котором
+// открытые скобки, индексы и вызовы отделяют вложенные выражения.
+// Унарный оператор относится к одному терму, бинарные применяются слева направо.
+Expr* Parser::parseOperators(bool singleTerm) {
+    using Kind = PendingOperator::Kind;
+    std::vector<Expr*> operands;
+    std::vector<PendingOperator> operators;
+    size_t groups = 0;
+
+    // Применяет операторы до ближайшей открытой скобки
+    auto reduce = [&]() {
+        while (!operators.empty() &&
+            (operators.back().kind == Kind::UNARY || operators.back().kind == Kind::BINARY)) {
+            PendingOperator op = operators.back();
+            operators.pop_back();
+            Expr* node;
+            if (op.kind == Kind::UNARY) {
+                node = makeExpr(ExprKind::UNARY_OP, { operands.back() });
+            }
+            else {
+                Expr* right = operands.back();
+                operands.pop_back();
+                node = makeExpr(ExprKind::BINARY_OP, { operands.back(), right });
+            }
+            node->op = op.text;
+            hashExpr(node);
+            operands.back() = node;
+        }
+    };
+    auto push = [&](Expr* node) {
+        hashExpr(node);
+        operands.push_back(node);
+    };
+
+    bool expectOperand = true;
+    while (true) {
+        if (expectOperand) {
+            if (operators.size() >= maxDepth) {
+                throw std::runtime_error("Expression nesting exceeds the limit of " + std::to_string(maxDepth));
+            }
+            expectOperand = false;
+
+            switch (tokenizer.tokenType()) {
+            case TokenType::INT_CONST: {
+                Expr* node = makeExpr(ExprKind::INT_CONST);
+                node->value = tokenizer.intVal();
+                eat();
+                push(node);
+                break;
+            }
+
+            case TokenType::STRING_CONST: {
+                Expr* node = makeExpr(ExprKind::STRING_CONST);
+                node->name = arena.copy(tokenizer.stringVal());
+                eat();
+                push(node);
+                break;
+            }
+
+            case TokenType::KEYWORD:
+                switch (tokenizer.keyWord()) {
+                case Keyword::TRUE:
+                case Keyword::FALSE:
+                case Keyword::NULL_:
+                case Keyword::THIS: {
+                    Expr* node = makeExpr(ExprKind::KEYWORD_CONST);
+                    node->keyword = tokenizer.keyWord();
+                    eat();
+                    push(node);
+                    break;
+                }
+                default:
+                    throw std::runtime_error("Invalid keyword constant");
+                }
+                break;
+
+            case TokenType::IDENTIFIER: {
+                std::string_view identifier = consumeIdentifier();
+
+                if (atSymbol("[")) {
+                    eat();
+                    operators.push_back({ Kind::INDEX, identifier });
+                    groups++;
+                    expectOperand = true;
+                }
+                else if (atSymbol("(") || atSymbol(".")) {
+                    Expr* call = parseCallHeader(identifier);
+                    if (atSymbol(")")) {
+                        eat();
+                        push(call);
+                    }
+                    else {
+                        operators.push_back({ Kind::CALL, {}, call, operands.size() });
+                        groups++;
+                        expectOperand = true;
+                    }
+                }
+                else {
+                    Expr* node = makeExpr(ExprKind::VARIABLE);
+                    node->name = identifier;
+                    push(node);
+                }
+                break;
+            }
+
+            case TokenType::SYMBOL:
+                if (atSymbol("(")) {
+                    eat();
+                    operators.push_back({ Kind::PAREN });
+                    groups++;
+                }
+                else if (isUnaryOp()) {
+                    operators.push_back({ Kind::UNARY, arena.copy(tokenizer.symbol()) });
+                    eat();
+                }
+                else {
+                    throw std::runtime_error("Unexpected symbol '" + tokenizer.symbol() + "' in expression");
+                }
+                expectOperand = true;
+                break;
+
+            default:
+                throw std::runtime_error("Unexpected token type");
+            }
+            continue;
+        }
+
+        // После операнда: бинарный оператор или закрытие скобки
+        if (tokenizer.tokenType() == TokenType::SYMBOL && isOperator(tokenizer.symbol()) &&
+            !(singleTerm && groups == 0)) {
+            reduce();
+            operators.push_back({ Kind::BINARY, arena.copy(tokenizer.symbol()) });
+            eat();
+            expectOperand = true;
+            continue;
+        }
+        if (groups == 0) break;
+
+        reduce();
+        PendingOperator group = operators.back();
+        if (group.kind == Kind::CALL && atSymbol(",")) {
+            eat();
+            expectOperand = true;
+            continue;
+        }
+        consumeSymbol(group.kind == Kind::INDEX ? "]" : ")");
+        operators.pop_back();
+        groups--;
+
+        if (group.kind == Kind::INDEX) {
+            Expr* node = makeExpr(ExprKind::ARRAY_ACCESS, { operands.back() });
+            node->name = group.text;
+            operands.pop_back();
+            push(node);
+        }
+        else if (group.kind == Kind::CALL) {
+            size_t count = operands.size() - group.firstArgument;
+            group.call->operands = arena.copy<Expr*>(operands.data() + group.firstArgument, count);
+            operands.resize(group.firstArgument);
+            push(group.call);
+        }
+    }
+
+    reduce();
+    return operands.back();
+}
+
+// Имя вызова (возможно с классом или объектом) и открывающая скобка
+Expr* Parser::parseCallHeader(std::string_view identifier) {
+    Expr* call = makeExpr(ExprKind::SUBROUTINE_CALL);
+
+    if (atSymbol(".")) {
+        eat();
+        call->qualifier = identifier;
+        call->name = consumeIdentifier();
+    }
+    else {
+        call->name = identifier;
+    }
+    consumeSymbol("(");
+    return call;
+}
+
+Expr* Parser::parseSubroutineCall(std::string_view identifier) {
+    Expr* call = parseCallHeader(identifier);
+
+    std::vector<Expr*> arguments;
+    while (!atSymbol(")")) {
+        arguments.push_back(parseExpression());
+        if (atSymbol(",")) {
+            eat();
+        }
+        else {
+            break;
+        }
+    }
+    consumeSymbol(")");
+    call->operands = arena.copy(arguments);
+
+    hashExpr(call);
+    return call;
+}
+
+// Тип переменной: int, char, boolean или имя класса
+std::string_view Parser::parseType() {
+    std::string_view type;
+    if (tokenizer.tokenType() == TokenType::KEYWORD) {
+        switch (tokenizer.keyWord()) {
+        case Keyword::INT:     type = "int"; break;
+        case Keyword::CHAR:    type = "char"; break;
+        case Keyword::BOOLEAN: type = "boolean"; break;
+        default: throw std::runtime_error("Invalid type '" + keywordToString(tokenizer.keyWord()) + "'");
+        }
+    }
+    else if (tokenizer.tokenType() == TokenType::IDENTIFIER) {
+        type = arena.copy(tokenizer.identifier());
+    }
+    else {
+        throw std::runtime_error("Expected type");
+    }
+    eat();
+    return type;
+}
+
+Expr* Parser::makeExpr(ExprKind kind, std::initializer_list<Expr*> operands) {
+    Expr* expr = arena.make<Expr>();
+    expr->kind = kind;
+    expr->operands = arena.copy<Expr*>(operands.begin(), operands.size());
+    return expr;
+}
+
+bool Parser::atKeyword(Keyword keyword) const {
+    return tokenizer.tokenType() == TokenType::KEYWORD && tokenizer.keyWord() == keyword;
+}
+
+bool Parser::atSymbol(const std::string& symbol) const {
+    return tokenizer.tokenType() == TokenType::SYMBOL && tokenizer.symbol() == symbol;
+}
+
+void Parser::eat() {
+    if (tokenizer.hasMoreTokens()) {
+        tokenizer.advance();
+    }
+}
+
+std::string_view Parser::consumeIdentifier() {
+    if (tokenizer.tokenType() != TokenType::IDENTIFIER) {
+        throw std::runtime_error("Expected identifier");
+    }
+    std::string_view identifier = arena.copy(tokenizer.identifier());
+    eat();
+    return identifier;
+}
+
+// Потребляет символ, проверяя его корректность
+void Parser::consumeSymbol(const std::string& symbol) {
+    if (!atSymbol(symbol)) {
+        std::string msg = "Expected '" + symbol + "' got '";
+        msg += (tokenizer.tokenType() == TokenType::SYMBOL)
+            ? tokenizer.symbol()
+            : "non-symbol";
+        msg += "'";
+        throw std::runtime_error(msg);
+    }
+    eat();
+}
+
+void Parser::setDebugMode(bool mode) {
+    debugMode = mode;
+}
+
+// Потребляет ключевое слово, проверяя его корректность
+void Parser::consumeKeyword(Keyword expectedKeyword) {
+    if (debugMode) {
+        std::string currentTokenStr;
+
+        switch (tokenizer.tokenType()) {
+        case TokenType::KEYWORD:
+            currentTokenStr = keywordToString(tokenizer.keyWord());
+            break;
+        case TokenType::IDENTIFIER:
+            currentTokenStr = tokenizer.identifier();
+            break;
+        case TokenType::SYMBOL:
+            currentTokenStr = tokenizer.symbol();
+            break;
+        case TokenType::INT_CONST:
+            currentTokenStr = std::to_string(tokenizer.intVal());
+            break;
+        case TokenType::STRING_CONST:
+            currentTokenStr = "\"" + tokenizer.stringVal() + "\"";
+            break;
+        default:
+            currentTokenStr = "UNKNOWN";
+        }
+
+        std::cout << "DEBUG: Current token: " << currentTokenStr << std::endl;
+    }
+
+    if (!atKeyword(expectedKeyword)) {
+        std::string expected = keywordToString(expectedKeyword);
+        std::string actual = (tokenizer.tokenType() == TokenType::KEYWORD)
+            ? keywordToString(tokenizer.keyWord())
+            : "non-keyword";
+        throw std::runtime_error("Expected keyword '" + expected + "' got '" + actual + "'");
+    }
+    eat();
+}
+
+bool Parser::isOperator(const std::string& symbol) const {
+    static const std::unordered_set<std::string> operators = {
+        "+", "-", "*", "/",
+        "&", "|", "<", ">", "=","<=",">="
+    };
+    return operators.count(symbol) != 0;
+}
+
+// Определяет, является ли текущий символ унарным оператором
+bool Parser::isUnaryOp() const {
+    return atSymbol("-") || atSymbol("~");
+}
@@ -0,0 +1,88 @@
+﻿#pragma once
+#include "JackTokenizer.h"
+#include "Arena.h"
+#include "Ast.h"
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Синтаксический анализатор: строит дерево в арене, код не генерирует.
+// Вложенные выражения и блоки разбираются на явных стеках, поэтому
+// глубина вложенности ограничена только maxDepth, а не стеком потока.
+class Parser {
+public:
+    Parser(JackTokenizer& tokenizer, Arena& arena, size_t maxDepth = 100000);
+
+    // Отладочный вывод разбираемых ключевых слов
+    void setDebugMode(bool mode);
+
+    // Разбор класса целиком
+    ClassDec* parseClass();
+    void parseClassVarDec(std::vector<VariableDec>& variables);
+    SubroutineDec* parseSubroutine();
+
+    // Заголовок подпрограммы: вид, тип, имя и параметры (без тела)
+    SubroutineDec* parseSubroutineSignature();
+    std::span<VariableDec> parseParameterList();
+    void parseVarDec(std::vector<VariableDec>& locals);
+
+    // Операторы
+    std::span<Statement*> parseStatements();
+    Statement* parseLet();
+    Statement* parseIf();
+    Statement* parseWhile();
+    Statement* parseDo();
+    Statement* parseReturn();
+
+    // Заголовки if/while до '{' включительно; тело разбирает вызывающий
+    Statement* parseIfHeader();
+    Statement* parseWhileHeader();
+
+    // После '}' блока then: есть ли ветвь else (потребляет "else {")
+    bool parseElse();
+
+    // Выражения
+    Expr* parseExpression();
+    Expr* parseTerm();
+    Expr* parseSubroutineCall(std::string_view identifier);
+
+    // Работа с токенами
+    bool atKeyword(Keyword keyword) const;
+    bool atSymbol(const std::string& symbol) const;
+    void consumeSymbol(const std::string& symbol);
+    void consumeKeyword(Keyword keyword);
+    std::string_view consumeIdentifier();
+    void eat();
+
+private:
+    // Открытый блок операторов: тело if/while или ветвь else
+    struct Block {
+        Statement* owner = nullptr;
+        bool inElse = false;
+        std::vector<Statement*> statements;
+    };
+
+    // Оператор или открытая скобка в стеке разбора выражения
+    struct PendingOperator {
+        enum class Kind { UNARY, BINARY, PAREN, INDEX, CALL } kind;
+        std::string_view text;       // Оператор или имя массива
+        Expr* call = nullptr;        // CALL: узел вызова
+        size_t firstArgument = 0;    // CALL: первый аргумент в стеке операндов
+    };
+
+    void parseBlocks(std::vector<Block>& blocks, bool singleStatement);
+    void openBlock(std::vector<Block>& blocks, Statement* owner);
+    void closeBlock(std::vector<Block>& blocks);
+    Expr* parseOperators(bool singleTerm);
+    Expr* parseCallHeader(std::string_view identifier);
+    std::string_view parseType();
+    Expr* makeExpr(ExprKind kind, std::initializer_list<Expr*> operands = {});
+    bool isOperator(const std::string& symbol) const;
+    bool isUnaryOp() const;
+
+    JackTokenizer& tokenizer;
+    Arena& arena;
+    size_t maxDepth;
+    bool debugMode = false;
+};
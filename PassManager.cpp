@@ -0,0 +1,49 @@
+﻿#include "PassManager.h"
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+ptrdiff_t instructionCount(const VMFunction& function) {
+    ptrdiff_t count = 0;
+    for (const auto& instruction : function.body) {
+        if (instruction.op != VMOp::NOP) count++;
+    }
+    return count;
+}
+
+}
+
+PassManager::PassManager(const CompilerOptions& options, std::ostream* dump)
+    : dumpAfter(options.dumpAfter), dump(dump != nullptr ? dump : &std::cerr) {
+    for (size_t pass = 0; pass < OPTIMIZATION_PASS_COUNT; pass++) {
+        enabled[pass] = options.passEnabled(static_cast<OptimizationPass>(pass));
+    }
+}
+
+void PassManager::add(OptimizationPass pass, Run run) {
+    if (!enabled[static_cast<size_t>(pass)]) return;
+    pipeline.push_back({ pass, std::move(run) });
+}
+
+void PassManager::run(VMFunction& function, FileStatistics* statistics) const {
+    for (const auto& entry : pipeline) {
+        if (statistics == nullptr) {
+            entry.run(function);
+        }
+        else {
+            ptrdiff_t before = instructionCount(function);
+            auto start = std::chrono::steady_clock::now();
+            entry.run(function);
+            PassStatistics& pass = statistics->passes[static_cast<size_t>(entry.pass)];
+            pass.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            pass.runs++;
+            pass.removed += before - instructionCount(function);
+        }
+
+        if (dumpAfter == "all" || dumpAfter == passName(entry.pass)) {
+            *dump << "// after " << passName(entry.pass) << "\n";
+            writeFunctionText(*dump, function);
+        }
+    }
+}
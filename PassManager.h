@@ -0,0 +1,36 @@
+﻿#pragma once
+#include "CompileStatistics.h"
+#include "CompilerOptions.h"
+#include "VMInstruction.h"
+#include <array>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Конвейер проходов оптимизации подпрограммы. Проходы выполняются в порядке
+// OptimizationPass, если включены в настройках (-O, --enable-pass,
+// --disable-pass). Время и число удалённых команд каждого прохода идут в
+// FileStatistics (--stats), функция после прохода options.dumpAfter - в dump.
+class PassManager {
+public:
+    using Run = std::function<void(VMFunction& function)>;
+
+    explicit PassManager(const CompilerOptions& options, std::ostream* dump = nullptr);
+
+    // Добавляет проход, если он включён
+    void add(OptimizationPass pass, Run run);
+
+    void run(VMFunction& function, FileStatistics* statistics) const;
+
+private:
+    struct Entry {
+        OptimizationPass pass;
+        Run run;
+    };
+
+    std::array<bool, OPTIMIZATION_PASS_COUNT> enabled{};
+    std::vector<Entry> pipeline;
+    std::string dumpAfter;
+    std::ostream* dump;
+};
@@ -0,0 +1,74 @@
+﻿#include "Profile.h"
+#include "Hash.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const char* const PROFILE_HEADER = "jackc-profile 1";
+
+}
+
+Profile Profile::load(const std::filesystem::path& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+
+    std::string line;
+    if (!std::getline(in, line) || line != PROFILE_HEADER) {
+        throw std::runtime_error("Invalid profile: " + path.string());
+    }
+
+    Profile profile;
+    size_t number = 1;
+    while (std::getline(in, line)) {
+        number++;
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        std::string site;
+        uint64_t count = 0;
+        if (!(fields >> site >> count)) {
+            throw std::runtime_error("Invalid profile: " + path.string() + ":" + std::to_string(number));
+        }
+        profile.add(site, count);
+    }
+    return profile;
+}
+
+void Profile::save(const std::filesystem::path& path) const {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        throw std::runtime_error("Failed to open output file: " + path.string());
+    }
+    out << PROFILE_HEADER << "\n";
+    for (const auto& [site, count] : counts) {
+        out << site << " " << count << "\n";
+    }
+}
+
+void Profile::add(const std::string& site, uint64_t count) {
+    uint64_t& total = counts[site];
+    total += count;
+    maxCount = std::max(maxCount, total);
+}
+
+uint64_t Profile::count(std::string_view site) const {
+    auto it = counts.find(site);
+    return it != counts.end() ? it->second : 0;
+}
+
+bool Profile::isHot(uint64_t count) const {
+    return count > 0 && count * 100 >= maxCount;
+}
+
+uint64_t Profile::hash() const {
+    uint64_t result = 0;
+    for (const auto& [site, count] : counts) {
+        result = xxhash64(site, result);
+        result = xxhash64(&count, sizeof(count), result);
+    }
+    return result;
+}
@@ -0,0 +1,38 @@
+﻿#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+// Счётчики исполнения из инструментированного прогона (--instrument).
+// Место - точка входа подпрограммы ("Класс.имя") или блок операторов
+// ("Класс.имя#N": then/else каждого if и тело каждого while по порядку
+// в исходнике). Номера блоков зависят только от исходника, поэтому
+// профиль подходит к той же программе, собранной с другими настройками.
+//
+// Формат файла:
+//   jackc-profile 1
+//   <место> <число исполнений>
+class Profile {
+public:
+    static Profile load(const std::filesystem::path& path);
+    void save(const std::filesystem::path& path) const;
+
+    void add(const std::string& site, uint64_t count);
+
+    // Число исполнений места (0 - неизвестное место)
+    uint64_t count(std::string_view site) const;
+
+    // Горячее место: не реже 1% самого частого
+    bool isHot(uint64_t count) const;
+
+    size_t size() const { return counts.size(); }
+
+    // Хеш содержимого (входит в ключ кеша сборки)
+    uint64_t hash() const;
+
+private:
+    std::map<std::string, uint64_t, std::less<>> counts;
+    uint64_t maxCount = 0;
+};
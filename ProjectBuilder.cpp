@@ -0,0 +1,281 @@
+﻿#include "ProjectBuilder.h"
+#include "AllocationTracker.h"
+#include "ClassInterface.h"
+#include "JackCompiler.h"
+#include "Hash.h"
+#include "IncrementalCompiler.h"
+#include "VMBytecode.h"
+#include <chrono>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string readSource(const fs::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}
+
+ProjectBuilder::ProjectBuilder(const CompilerOptions& o, const std::string& cacheDirectory, bool interfaces)
+    : options(o), useInterfaces(interfaces), configurationHash(xxhash64(o.signature())) {
+    if (!cacheDirectory.empty()) {
+        cache = std::make_unique<BuildCache>(cacheDirectory, options.signature());
+    }
+}
+
+fs::path ProjectBuilder::interfacePath(const fs::path& jackFile) const {
+    fs::path path = jackFile;
+    return path.replace_extension(".vmi");
+}
+
+fs::path ProjectBuilder::outputPath(const fs::path& jackFile) const {
+    fs::path path = jackFile;
+    return path.replace_extension(options.bytecodeOutput ? ".vmb" : ".vm");
+}
+
+fs::path ProjectBuilder::lineMapPath(const fs::path& jackFile) const {
+    fs::path path = jackFile;
+    return path.replace_extension(".vmmap");
+}
+
+bool ProjectBuilder::outputsExist(const fs::path& jackFile) const {
+    return fs::exists(outputPath(jackFile)) && (!options.lineMap || fs::exists(lineMapPath(jackFile)));
+}
+
+void ProjectBuilder::build(const std::vector<fs::path>& jackFiles) {
+    // Исходники нужны хешам заранее
+    std::vector<std::string> sources(jackFiles.size());
+    std::vector<uint64_t> sourceHashes(jackFiles.size());
+    for (size_t i = 0; i < jackFiles.size(); i++) {
+        sources[i] = readSource(jackFiles[i]);
+        sourceHashes[i] = xxhash64(sources[i]);
+    }
+
+    // Интерфейсы неизменённых классов: такие классы не компилируются заново,
+    // если их запросы выполняются
+    std::vector<fs::path> interfacePaths;
+    std::vector<bool> upToDate(jackFiles.size(), false);
+    if (useInterfaces) {
+        for (const auto& jackFile : jackFiles) {
+            interfacePaths.push_back(interfacePath(jackFile));
+        }
+        upToDate = matchingInterfaces(interfacePaths, sourceHashes, configurationHash);
+    }
+
+    // Как при чистой сборке, каждый файл видит только объявления файлов
+    // перед ним, поэтому таблица проекта собирается заново по порядку
+    projectTable = SymbolTable();
+
+    // Обрабатываем каждый файл
+    for (size_t fileIndex = 0; fileIndex < jackFiles.size(); fileIndex++) {
+        const fs::path& jackFile = jackFiles[fileIndex];
+        fs::path vmPath = outputPath(jackFile);
+
+        // Файл, не изменившийся с прошлой сборки в этом процессе
+        auto state = files.find(jackFile);
+        if (state != files.end() && state->second.sourceHash == sourceHashes[fileIndex] &&
+            outputsExist(jackFile) && state->second.summary.queriesHold(projectTable)) {
+            projectTable.importMethods(state->second.summary.methods);
+            continue;
+        }
+        if (upToDate[fileIndex] && outputsExist(jackFile)) {
+            ClassInterface classInterface(interfacePaths[fileIndex]);
+            if (classInterface.queriesHold(projectTable)) {
+                classInterface.exportTo(projectTable);
+                files[jackFile] = { sourceHashes[fileIndex], classInterface.summary() };
+                std::cout << "Up to date: " << jackFile.filename() << "\n";
+                continue;
+            }
+        }
+
+        // С интерфейсами файл без действительного .vmi компилируется, чтобы записать его.
+        // Карты строк в кеше нет.
+        if (cache && !useInterfaces && !options.lineMap) {
+            SymbolTable::FileSummary summary;
+            if (cache->restore(sources[fileIndex], vmPath, projectTable, &summary)) {
+                files[jackFile] = { sourceHashes[fileIndex], std::move(summary) };
+                std::cout << "Up to date: " << jackFile.filename() << "\n";
+                continue;
+            }
+        }
+
+        compileFile(jackFile, std::move(sources[fileIndex]), sourceHashes[fileIndex]);
+    }
+}
+
+size_t ProjectBuilder::update(const std::vector<fs::path>& changed, const std::vector<fs::path>& removed) {
+    for (const auto& jackFile : removed) {
+        auto it = files.find(jackFile);
+        if (it != files.end()) {
+            files.erase(it);
+
+            // Выходные файлы удалённого класса больше не нужны
+            std::error_code error;
+            fs::remove(outputPath(jackFile), error);
+            if (useInterfaces) fs::remove(interfacePath(jackFile), error);
+        }
+    }
+
+    // Файлы, у которых действительно изменилось содержимое
+    std::map<fs::path, std::string> dirty;
+    std::set<fs::path> order;
+    for (const auto& [jackFile, state] : files) {
+        order.insert(jackFile);
+    }
+    for (const auto& jackFile : changed) {
+        std::string source = readSource(jackFile);
+        auto it = files.find(jackFile);
+        if (it != files.end() && it->second.sourceHash == xxhash64(source)) continue;
+        dirty.emplace(jackFile, std::move(source));
+        order.insert(jackFile);
+    }
+    if (dirty.empty() && removed.empty()) return 0;
+
+    // Проход в порядке чистой сборки (пути отсортированы, как у getJackFiles):
+    // файл компилируется, если он изменился или его запросы к объявлениям
+    // предыдущих файлов дают новые ответы
+    projectTable = SymbolTable();
+    size_t compiled = 0;
+    for (const auto& jackFile : order) {
+        auto source = dirty.find(jackFile);
+        if (source == dirty.end()) {
+            const FileState& state = files.at(jackFile);
+            if (state.summary.queriesHold(projectTable)) {
+                projectTable.importMethods(state.summary.methods);
+                continue;
+            }
+        }
+        std::string text = source != dirty.end() ? std::move(source->second) : readSource(jackFile);
+        uint64_t sourceHash = xxhash64(text);
+        compileFile(jackFile, std::move(text), sourceHash);
+        compiled++;
+    }
+    return compiled;
+}
+
+void ProjectBuilder::compileFile(const fs::path& jackFile, std::string source, uint64_t sourceHash) {
+    fs::path vmPath = outputPath(jackFile);
+
+    std::cout << "Compiling file: " << jackFile.filename() << "\n";
+
+    auto previous = files.find(jackFile);
+
+    // Получаем имя класса из имени файла
+    std::string className = jackFile.stem().string();
+    std::string cacheSource = cache ? source : std::string();
+    SymbolTable::FileSummary summary;
+    int fieldCount = 0;
+    int staticCount = 0;
+    std::string detail;
+
+    FileStatistics fileStatistics;
+    FileStatistics* statistics = compileStatistics != nullptr ? &fileStatistics : nullptr;
+    auto start = std::chrono::steady_clock::now();
+
+    if (incremental) {
+        // Файл, уже скомпилированный в этом процессе, компилируется по правке,
+        // если код его подпрограмм не зависит от изменившихся объявлений
+        auto& compiler = editors[jackFile];
+        bool reuse = compiler != nullptr && previous != files.end() &&
+            previous->second.summary.queriesHold(projectTable);
+        if (compiler == nullptr) {
+            compiler = std::make_unique<IncrementalCompiler>(jackFile.string(), options, &projectTable);
+        }
+        if (reuse) {
+            compiler->update(std::move(source));
+        }
+        else {
+            compiler->compile(std::move(source));
+        }
+
+        std::ofstream out(vmPath, options.bytecodeOutput ? std::ios::binary : std::ios::out);
+        if (!out.is_open()) {
+            throw std::runtime_error("Failed to open output file: " + vmPath.string());
+        }
+        if (options.bytecodeOutput) {
+            out << encodeBytecode(parseFunctionsText(compiler->vm()));
+        }
+        else {
+            compiler->writeVm(out);
+        }
+        if (statistics != nullptr) {
+            statistics->bytesWritten = static_cast<size_t>(std::max<std::streamoff>(0, out.tellp()));
+        }
+
+        summary = compiler->summary();
+        fieldCount = compiler->fieldCount();
+        staticCount = compiler->staticCount();
+        detail = " (" + std::to_string(compiler->lastCompiled()) + " of " +
+            std::to_string(compiler->subroutineCount()) + " subroutines)";
+    }
+    else {
+        // Инициализируем компоненты компилятора
+        JackTokenizer tokenizer(jackFile.string(), std::move(source));
+        tokenizer.setDebugMode(options.debugOutput);
+        tokenizer.setStatistics(statistics);
+        VMWriter vmWriter(vmPath.string(), options.bytecodeOutput ? VMFormat::BYTECODE : VMFormat::TEXT);
+        vmWriter.setDebugMode(options.debugOutput);
+        vmWriter.setStatistics(statistics);
+        if (options.lineMap) {
+            vmWriter.setLineMap(lineMapPath(jackFile).string(), jackFile.filename().string());
+        }
+        SymbolTable symbolTable;
+        symbolTable.setProjectTable(&projectTable);
+
+        // Компилируем; лексер и VMWriter сами отмечают свои этапы
+        AllocationScope scope(AllocationPhase::PARSER);
+        compileClass(tokenizer, vmWriter, symbolTable, className, options, arena);
+
+        summary = symbolTable.summary();
+        fieldCount = symbolTable.varCount(VarKind::FIELD);
+        staticCount = symbolTable.varCount(VarKind::STATIC);
+        fileStatistics.symbols = symbolTable.definitionCount();
+    }
+
+    if (statistics != nullptr) {
+        fileStatistics.file = jackFile.filename().string();
+        fileStatistics.totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        compileStatistics->add(std::move(fileStatistics));
+    }
+
+    projectTable.importMethods(summary.methods);
+    if (cache) {
+        cache->store(cacheSource, vmPath, summary);
+    }
+    if (useInterfaces) {
+        ClassInterface::write(interfacePath(jackFile), sourceHash, configurationHash, className,
+            fieldCount, staticCount, summary);
+    }
+    files[jackFile] = { sourceHash, std::move(summary) };
+
+    std::cout << "Compiled: "
+        << jackFile.filename() << " -> "
+        << vmPath.filename() << detail << "\n";
+}
+
+void ProjectBuilder::setIncremental(bool enabled) {
+    incremental = enabled;
+    if (!incremental) {
+        editors.clear();
+    }
+}
+
+void ProjectBuilder::setCompileStatistics(CompileStatistics* statistics) {
+    compileStatistics = statistics;
+}
+
+void ProjectBuilder::printStatistics(std::ostream& out) const {
+    if (cache) {
+        cache->printStatistics(out);
+    }
+}
@@ -0,0 +1,71 @@
+﻿#pragma once
+#include "Arena.h"
+#include "BuildCache.h"
+#include "CompileStatistics.h"
+#include "CompilerOptions.h"
+#include "IncrementalCompiler.h"
+#include "SymbolTable.h"
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Сборка проекта: компилирует .jack файлы с общей таблицей проекта,
+// кешем и интерфейсами. Таблица проекта, арена и сведения о каждом
+// файле сохраняются между сборками, поэтому update() компилирует
+// только изменённые файлы и те, чьи запросы к ним дают новые ответы.
+class ProjectBuilder {
+public:
+    ProjectBuilder(const CompilerOptions& options, const std::string& cacheDirectory, bool useInterfaces);
+
+    // Полная сборка списка файлов
+    void build(const std::vector<std::filesystem::path>& jackFiles);
+
+    // Пересборка после изменений. Возвращает число скомпилированных файлов.
+    size_t update(const std::vector<std::filesystem::path>& changed,
+        const std::vector<std::filesystem::path>& removed);
+
+    // Держать разобранные файлы в памяти и после правки компилировать
+    // только затронутые подпрограммы (IncrementalCompiler)
+    void setIncremental(bool enabled);
+
+    void printStatistics(std::ostream& out) const;
+
+    // Собирать время этапов и счётчики скомпилированных файлов (--stats)
+    void setCompileStatistics(CompileStatistics* statistics);
+
+private:
+    // Что известно о файле после последней сборки
+    struct FileState {
+        uint64_t sourceHash = 0;
+        SymbolTable::FileSummary summary;
+    };
+
+    void compileFile(const std::filesystem::path& jackFile, std::string source, uint64_t sourceHash);
+    std::filesystem::path interfacePath(const std::filesystem::path& jackFile) const;
+    std::filesystem::path outputPath(const std::filesystem::path& jackFile) const;
+    std::filesystem::path lineMapPath(const std::filesystem::path& jackFile) const;
+    // Выходной файл (и карта строк, если она нужна) уже записан
+    bool outputsExist(const std::filesystem::path& jackFile) const;
+
+    CompilerOptions options;
+    bool useInterfaces;
+    uint64_t configurationHash;
+    std::unique_ptr<BuildCache> cache;
+
+    // Память деревьев одного файла, освобождается после его компиляции
+    Arena arena;
+
+    // Подпрограммы уже скомпилированных классов
+    SymbolTable projectTable;
+
+    std::map<std::filesystem::path, FileState> files;
+
+    CompileStatistics* compileStatistics = nullptr;
+
+    bool incremental = false;
+    std::map<std::filesystem::path, std::unique_ptr<IncrementalCompiler>> editors;
+};
@@ -0,0 +1,123 @@
+﻿#include "Superinstructions.h"
+
+namespace {
+
+struct Comparison {
+    VMOp compare;
+    bool negated;
+    VMOp jump;
+};
+
+const Comparison COMPARISONS[] = {
+    { VMOp::EQ, false, VMOp::IF_EQ }, { VMOp::EQ, true, VMOp::IF_NE },
+    { VMOp::LT, false, VMOp::IF_LT }, { VMOp::LT, true, VMOp::IF_GE },
+    { VMOp::GT, false, VMOp::IF_GT }, { VMOp::GT, true, VMOp::IF_LE },
+};
+
+bool is(const VMInstruction& instruction, VMOp op, Segment segment, int index) {
+    return instruction.op == op && instruction.segment == segment && instruction.index == index;
+}
+
+}
+
+void fuseSuperinstructions(VMFunction& function) {
+    std::vector<VMInstruction> body;
+    for (auto& instruction : function.body) {
+        if (instruction.op != VMOp::NOP) body.push_back(std::move(instruction));
+    }
+
+    std::vector<VMInstruction> fused;
+    fused.reserve(body.size());
+    auto at = [&](size_t i) -> const VMInstruction& {
+        static const VMInstruction none{ VMOp::NOP };
+        return i < body.size() ? body[i] : none;
+    };
+    for (size_t i = 0; i < body.size(); i++) {
+        const VMInstruction& first = body[i];
+        uint32_t line = first.line;
+
+        if (first.op == VMOp::PUSH && first.segment == Segment::LOCAL &&
+            is(at(i + 1), VMOp::PUSH, Segment::CONSTANT, 1) &&
+            (at(i + 2).op == VMOp::ADD || at(i + 2).op == VMOp::SUB) &&
+            is(at(i + 3), VMOp::POP, Segment::LOCAL, first.index)) {
+            fused.push_back({ at(i + 2).op == VMOp::ADD ? VMOp::INC : VMOp::DEC, Segment::LOCAL, first.index, {}, line });
+            i += 3;
+            continue;
+        }
+        if (is(first, VMOp::POP, Segment::TEMP, 0) && is(at(i + 1), VMOp::POP, Segment::POINTER, 1) &&
+            is(at(i + 2), VMOp::PUSH, Segment::TEMP, 0) && is(at(i + 3), VMOp::POP, Segment::THAT, 0)) {
+            fused.push_back({ VMOp::STORE, Segment::NONE, 0, {}, line });
+            i += 3;
+            continue;
+        }
+        if (is(first, VMOp::POP, Segment::POINTER, 1) && is(at(i + 1), VMOp::PUSH, Segment::THAT, 0)) {
+            fused.push_back({ VMOp::LOAD, Segment::NONE, 0, {}, line });
+            i += 1;
+            continue;
+        }
+
+        bool negated = at(i + 1).op == VMOp::NOT;
+        const VMInstruction& jump = at(i + (negated ? 2 : 1));
+        const Comparison* comparison = nullptr;
+        for (const auto& candidate : COMPARISONS) {
+            if (candidate.compare == first.op && candidate.negated == negated) comparison = &candidate;
+        }
+        if (comparison != nullptr && jump.op == VMOp::IF_GOTO) {
+            fused.push_back({ comparison->jump, Segment::NONE, 0, jump.name, line });
+            i += negated ? 2 : 1;
+            continue;
+        }
+        fused.push_back(std::move(body[i]));
+    }
+    function.body.swap(fused);
+}
+
+bool hasSuperinstructions(const VMFunction& function) {
+    for (const auto& instruction : function.body) {
+        if (isSuperinstruction(instruction.op)) return true;
+    }
+    return false;
+}
+
+void lowerSuperinstructions(VMFunction& function) {
+    std::vector<VMInstruction> body;
+    body.reserve(function.body.size());
+    for (auto& instruction : function.body) {
+        uint32_t line = instruction.line;
+        switch (instruction.op) {
+        case VMOp::INC:
+        case VMOp::DEC:
+            body.push_back({ VMOp::PUSH, instruction.segment, instruction.index, {}, line });
+            body.push_back({ VMOp::PUSH, Segment::CONSTANT, 1, {}, line });
+            body.push_back({ instruction.op == VMOp::INC ? VMOp::ADD : VMOp::SUB, Segment::NONE, 0, {}, line });
+            body.push_back({ VMOp::POP, instruction.segment, instruction.index, {}, line });
+            break;
+        case VMOp::LOAD:
+            body.push_back({ VMOp::POP, Segment::POINTER, 1, {}, line });
+            body.push_back({ VMOp::PUSH, Segment::THAT, 0, {}, line });
+            break;
+        case VMOp::STORE:
+            body.push_back({ VMOp::POP, Segment::TEMP, 0, {}, line });
+            body.push_back({ VMOp::POP, Segment::POINTER, 1, {}, line });
+            body.push_back({ VMOp::PUSH, Segment::TEMP, 0, {}, line });
+            body.push_back({ VMOp::POP, Segment::THAT, 0, {}, line });
+            break;
+        case VMOp::IF_EQ:
+        case VMOp::IF_NE:
+        case VMOp::IF_LT:
+        case VMOp::IF_GT:
+        case VMOp::IF_LE:
+        case VMOp::IF_GE:
+            for (const auto& comparison : COMPARISONS) {
+                if (comparison.jump != instruction.op) continue;
+                body.push_back({ comparison.compare, Segment::NONE, 0, {}, line });
+                if (comparison.negated) body.push_back({ VMOp::NOT, Segment::NONE, 0, {}, line });
+            }
+            body.push_back({ VMOp::IF_GOTO, Segment::NONE, 0, std::move(instruction.name), line });
+            break;
+        default:
+            body.push_back(std::move(instruction));
+        }
+    }
+    function.body.swap(body);
+}
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include "VMInstruction.h"
+
+// Расширенный диалект VM: частые последовательности команд заменяются
+// одной суперкомандой. Смысл (включая pointer 1 и temp 0) не меняется.
+//   push local i, push constant 1, add|sub, pop local i  -> inc|dec local i
+//   eq|gt|lt, [not], if-goto L                           -> if-eq|ne|gt|le|lt|ge L
+//   pop pointer 1, push that 0                           -> load
+//   pop temp 0, pop pointer 1, push temp 0, pop that 0   -> store
+// Стандартные транслятор и эмулятор суперкоманд не знают: для них код
+// понижается обратно в обычные команды.
+
+// Заменяет последовательности суперкомандами; точки сохранения CSE убираются
+void fuseSuperinstructions(VMFunction& function);
+
+bool hasSuperinstructions(const VMFunction& function);
+
+// Заменяет суперкоманды исходными последовательностями
+void lowerSuperinstructions(VMFunction& function);
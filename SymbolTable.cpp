@@ -1,4 +1,5 @@
 #include "SymbolTable.h"
+#include <algorithm>
 #include <stdexcept>
 
 SymbolTable::SymbolTable()
@@ -10,32 +11,122 @@ void SymbolTable::startSubroutine() {
     varCount_ = 0;
 }
 
-void SymbolTable::defineMethod(const std::string& methodName, const std::string& returnType) {
-    methodReturnTypes[methodName] = returnType;
+void SymbolTable::defineMethod(std::string_view methodName, std::string_view returnType,
+    Keyword kind, int arity) {
+    methodDeclarations[std::string(methodName)] = { std::string(returnType), kind, arity };
 }
 
-std::string SymbolTable::getMethodReturnType(const std::string& methodName) const {
-    auto it = methodReturnTypes.find(methodName);
-    return (it != methodReturnTypes.end()) ? it->second : "unknown";
+std::string SymbolTable::getMethodReturnType(std::string_view methodName) const {
+    auto it = methodDeclarations.find(methodName);
+    if (it != methodDeclarations.end()) {
+        return it->second.returnType;
+    }
+    if (projectTable != nullptr) {
+        std::string returnType = projectTable->getMethodReturnType(methodName);
+        queries["type " + std::string(methodName)] = returnType;
+        return returnType;
+    }
+    return "unknown";
+}
+
+void SymbolTable::setMethodPurity(std::string_view methodName, Purity purity) {
+    methodPurity[std::string(methodName)] = purity;
+}
+
+Purity SymbolTable::getMethodPurity(std::string_view methodName) const {
+    // Функции ОС без побочных эффектов
+    static const NameMap<Purity> builtIn = {
+        {"Math.multiply", Purity::PURE}, {"Math.divide", Purity::PURE_MAY_FAIL},
+        {"Math.abs", Purity::PURE}, {"Math.min", Purity::PURE},
+        {"Math.max", Purity::PURE}, {"Math.sqrt", Purity::PURE_MAY_FAIL},
+        {"String.length", Purity::READS_MEMORY}, {"String.charAt", Purity::READS_MEMORY_MAY_FAIL}
+    };
+
+    auto it = methodPurity.find(methodName);
+    if (it != methodPurity.end()) {
+        return it->second;
+    }
+    if (projectTable != nullptr && methodDeclarations.find(methodName) == methodDeclarations.end()) {
+        Purity purity = projectTable->getMethodPurity(methodName);
+        queries["purity " + std::string(methodName)] = std::to_string(static_cast<int>(purity));
+        return purity;
+    }
+    auto builtInIt = builtIn.find(methodName);
+    return (builtInIt != builtIn.end()) ? builtInIt->second : Purity::IMPURE;
+}
+
+void SymbolTable::setProjectTable(const SymbolTable* project) {
+    projectTable = project;
+}
+
+const std::map<std::string, std::string>& SymbolTable::projectQueries() const {
+    return queries;
+}
+
+std::string SymbolTable::answerQuery(std::string_view query) const {
+    size_t space = query.find(' ');
+    std::string_view kind = query.substr(0, space);
+    std::string_view name = (space == std::string_view::npos) ? std::string_view() : query.substr(space + 1);
+    if (kind == "type") {
+        return getMethodReturnType(name);
+    }
+    return std::to_string(static_cast<int>(getMethodPurity(name)));
+}
+
+std::vector<SymbolTable::MethodInfo> SymbolTable::methods() const {
+    std::vector<MethodInfo> result;
+    for (const auto& [name, declaration] : methodDeclarations) {
+        auto it = methodPurity.find(name);
+        result.push_back({ name, declaration.returnType,
+            (it != methodPurity.end()) ? it->second : Purity::IMPURE,
+            declaration.kind, declaration.arity });
+    }
+    std::sort(result.begin(), result.end(), [](const MethodInfo& a, const MethodInfo& b) {
+        return a.name < b.name;
+    });
+    return result;
+}
+
+void SymbolTable::exportMethods(SymbolTable& project) const {
+    project.importMethods(methods());
+}
+
+void SymbolTable::importMethods(const std::vector<MethodInfo>& declarations) {
+    for (const auto& method : declarations) {
+        defineMethod(method.name, method.returnType, method.kind, method.arity);
+        setMethodPurity(method.name, method.purity);
+    }
+}
+
+SymbolTable::FileSummary SymbolTable::summary() const {
+    return { methods(), queries };
+}
+
+bool SymbolTable::FileSummary::queriesHold(const SymbolTable& project) const {
+    for (const auto& [query, answer] : queries) {
+        if (project.answerQuery(query) != answer) return false;
+    }
+    return true;
 }
 
 void SymbolTable::define(
-    const std::string& name,
-    const std::string& type,
+    std::string_view name,
+    std::string_view type,
     VarKind kind
 ) {
+    definitions++;
     switch (kind) {
     case VarKind::STATIC:
-        classTable[name] = { type, kind, staticCount++ };
+        classTable[std::string(name)] = { std::string(type), kind, staticCount++ };
         break;
     case VarKind::FIELD:
-        classTable[name] = { type, kind, fieldCount++ };
+        classTable[std::string(name)] = { std::string(type), kind, fieldCount++ };
         break;
     case VarKind::ARG:
-        subroutineTable[name] = { type, kind, argCount++ };
+        subroutineTable[std::string(name)] = { std::string(type), kind, argCount++ };
         break;
     case VarKind::VAR:
-        subroutineTable[name] = { type, kind, varCount_++ };
+        subroutineTable[std::string(name)] = { std::string(type), kind, varCount_++ };
         break;
     default:
         throw std::runtime_error("Invalid variable kind");
@@ -52,14 +143,14 @@ int SymbolTable::varCount(VarKind kind) const {
     }
 }
 
-VarKind SymbolTable::kindOf(const std::string& name) const {
-    //      
+VarKind SymbolTable::kindOf(std::string_view name) const {
+    // Сначала проверяем локальные переменные и аргументы
     auto it = subroutineTable.find(name);
     if (it != subroutineTable.end()) {
         return it->second.kind;
     }
 
-    //      
+    // Затем проверяем статические и поля класса
     it = classTable.find(name);
     if (it != classTable.end()) {
         return it->second.kind;
@@ -68,34 +159,34 @@ VarKind SymbolTable::kindOf(const std::string& name) const {
     return VarKind::NONE;
 }
 
-std::string SymbolTable::typeOf(const std::string& name) const {
-    //   
+std::string SymbolTable::typeOf(std::string_view name) const {
+    // Сначала проверяем подпрограмму
     auto it = subroutineTable.find(name);
     if (it != subroutineTable.end()) {
         return it->second.type;
     }
 
-    //   
+    // Затем проверяем класс
     it = classTable.find(name);
     if (it != classTable.end()) {
         return it->second.type;
     }
 
-    throw std::runtime_error("Variable not found: " + name);
+    throw std::runtime_error("Variable not found: " + std::string(name));
 }
 
-int SymbolTable::indexOf(const std::string& name) const {
-    //   
+int SymbolTable::indexOf(std::string_view name) const {
+    // Сначала проверяем подпрограмму
     auto it = subroutineTable.find(name);
     if (it != subroutineTable.end()) {
         return it->second.index;
     }
 
-    //   
+    // Затем проверяем класс
     it = classTable.find(name);
     if (it != classTable.end()) {
         return it->second.index;
     }
 
-    throw std::runtime_error("Variable not found: " + name);
+    throw std::runtime_error("Variable not found: " + std::string(name));
 }
\ No newline at end of file
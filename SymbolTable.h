@@ -1,30 +1,105 @@
 ﻿#pragma once
+#include "JackTokenizer.h"
+#include <map>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 enum class VarKind { STATIC, FIELD, ARG, VAR, NONE };
 
+// Побочные эффекты подпрограммы: IMPURE - может менять состояние,
+// READS_MEMORY - только читает кучу/поля/статические, PURE - зависит только от аргументов.
+// Варианты *_MAY_FAIL - то же, но вызов может завершиться ошибкой (деление
+// на ноль, индекс вне строки): его нельзя выполнять раньше охраняющей проверки.
+enum class Purity { IMPURE, READS_MEMORY, PURE, READS_MEMORY_MAY_FAIL, PURE_MAY_FAIL };
+
+inline bool mayFail(Purity purity) {
+    return purity == Purity::READS_MEMORY_MAY_FAIL || purity == Purity::PURE_MAY_FAIL;
+}
+
+// Побочные эффекты без признака ошибки
+inline Purity withoutFailure(Purity purity) {
+    if (purity == Purity::READS_MEMORY_MAY_FAIL) return Purity::READS_MEMORY;
+    if (purity == Purity::PURE_MAY_FAIL) return Purity::PURE;
+    return purity;
+}
+
+inline Purity withFailure(Purity purity, bool fails) {
+    if (!fails) return purity;
+    if (purity == Purity::READS_MEMORY) return Purity::READS_MEMORY_MAY_FAIL;
+    if (purity == Purity::PURE) return Purity::PURE_MAY_FAIL;
+    return purity;
+}
+
 class SymbolTable {
 public:
     SymbolTable();
 
-    void defineMethod(const std::string& methodName, const std::string& returnType);
+    void defineMethod(std::string_view methodName, std::string_view returnType,
+        Keyword kind = Keyword::FUNCTION, int arity = 0);
+
+    std::string getMethodReturnType(std::string_view methodName) const;
+
+    // Отметить подпрограмму как не имеющую побочных эффектов
+    void setMethodPurity(std::string_view methodName, Purity purity);
+
+    // Побочные эффекты подпрограммы (неизвестные считаются IMPURE)
+    Purity getMethodPurity(std::string_view methodName) const;
+
+    // Таблица проекта с подпрограммами уже скомпилированных классов.
+    // Подпрограммы, не найденные в этом файле, ищутся в ней.
+    void setProjectTable(const SymbolTable* project);
+
+    // Ответы таблицы проекта, использованные при компиляции файла:
+    // "purity Имя" или "type Имя" -> значение
+    const std::map<std::string, std::string>& projectQueries() const;
+
+    // Ответ этой таблицы на запрос вида "purity Имя" или "type Имя"
+    std::string answerQuery(std::string_view query) const;
 
-    std::string getMethodReturnType(const std::string& methodName) const;
+    // Подпрограммы, объявленные в этом файле
+    struct MethodInfo {
+        std::string name;
+        std::string returnType;
+        Purity purity;
+        Keyword kind;
+        int arity;
+    };
+    std::vector<MethodInfo> methods() const;
+
+    // Добавляет подпрограммы этого файла в таблицу проекта
+    void exportMethods(SymbolTable& project) const;
+
+    // Добавляет объявления подпрограмм
+    void importMethods(const std::vector<MethodInfo>& declarations);
+
+    // Объявления файла и ответы таблицы проекта, от которых зависит его код
+    struct FileSummary {
+        std::vector<MethodInfo> methods;
+        std::map<std::string, std::string> queries;
+
+        // Все запросы дают прежние ответы
+        bool queriesHold(const SymbolTable& project) const;
+    };
+    FileSummary summary() const;
 
     // Начать новую подпрограмму (сбрасывает таблицу ARG и VAR)
     void startSubroutine();
 
     // Добавить переменную в таблицу
-    void define(const std::string& name, const std::string& type, VarKind kind);
+    void define(std::string_view name, std::string_view type, VarKind kind);
 
     // Количество переменных заданного вида
     int varCount(VarKind kind) const;
 
+    // Всего определений переменных с начала файла (--stats)
+    size_t definitionCount() const { return definitions; }
+
     // Получить информацию о переменной
-    VarKind kindOf(const std::string& name) const;
-    std::string typeOf(const std::string& name) const;
-    int indexOf(const std::string& name) const;
+    VarKind kindOf(std::string_view name) const;
+    std::string typeOf(std::string_view name) const;
+    int indexOf(std::string_view name) const;
 
 private:
     struct Symbol {
@@ -33,10 +108,27 @@ private:
         int index;
     };
 
+    // Поиск по std::string_view без создания временной строки
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+    template <typename T>
+    using NameMap = std::unordered_map<std::string, T, NameHash, std::equal_to<>>;
+
     // Таблицы символов
-    std::unordered_map<std::string, Symbol> classTable;      // STATIC, FIELD
-    std::unordered_map<std::string, Symbol> subroutineTable; // ARG, VAR
-    std::unordered_map<std::string, std::string> methodReturnTypes; // methodName → returnType
+    NameMap<Symbol> classTable;      // STATIC, FIELD
+    NameMap<Symbol> subroutineTable; // ARG, VAR
+    size_t definitions = 0;
+    struct MethodDeclaration {
+        std::string returnType;
+        Keyword kind;
+        int arity;
+    };
+    NameMap<MethodDeclaration> methodDeclarations; // methodName → объявление
+    NameMap<Purity> methodPurity;           // methodName → Purity
+    const SymbolTable* projectTable = nullptr;
+    mutable std::map<std::string, std::string> queries;
     // Счетчики переменных
     int staticCount;
     int fieldCount;
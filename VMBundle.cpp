@@ -0,0 +1,66 @@
+﻿#include "VMBundle.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const char* const BUNDLE_HEADER = "// jackc-bundle 1\n";
+const int OFFSET_WIDTH = 10;
+
+std::string indexLine(const std::string& name, size_t offset, size_t size, size_t functions) {
+    char numbers[64];
+    std::snprintf(numbers, sizeof(numbers), " %0*zu %0*zu %zu\n", OFFSET_WIDTH, offset, OFFSET_WIDTH, size, functions);
+    return "// class " + name + numbers;
+}
+
+}
+
+std::string linkBundle(std::vector<CompiledClass> classes, const std::vector<LinkPass>& passes) {
+    std::sort(classes.begin(), classes.end(),
+        [](const CompiledClass& a, const CompiledClass& b) { return a.name < b.name; });
+    for (const auto& pass : passes) {
+        pass(classes);
+    }
+
+    std::vector<std::string> sections;
+    for (const auto& compiled : classes) {
+        std::ostringstream text;
+        for (const auto& function : compiled.functions) {
+            writeFunctionText(text, function);
+        }
+        sections.push_back(text.str());
+    }
+
+    // Длина заголовка не зависит от значений смещений: они фиксированной ширины
+    std::string classCount = "// classes " + std::to_string(classes.size()) + "\n";
+    const std::string end = "// end\n";
+    size_t offset = std::string(BUNDLE_HEADER).size() + classCount.size() + end.size();
+    for (const auto& compiled : classes) {
+        offset += indexLine(compiled.name, 0, 0, compiled.functions.size()).size();
+    }
+
+    std::string bundle = BUNDLE_HEADER + classCount;
+    for (size_t i = 0; i < classes.size(); i++) {
+        bundle += indexLine(classes[i].name, offset, sections[i].size(), classes[i].functions.size());
+        offset += sections[i].size();
+    }
+    bundle += end;
+    for (const auto& section : sections) {
+        bundle += section;
+    }
+    return bundle;
+}
+
+void writeBundle(const std::filesystem::path& path, const std::string& bundle) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Failed to open output file: " + path.string());
+    }
+    out.write(bundle.data(), static_cast<std::streamsize>(bundle.size()));
+    if (!out.flush()) {
+        throw std::runtime_error("Failed to write output file: " + path.string());
+    }
+}
@@ -0,0 +1,24 @@
+﻿#pragma once
+#include "JackCompiler.h"
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Связанный бандл: все классы программы в одном .vm файле.
+// Заголовок - комментарии VM, поэтому транслятор читает бандл как обычный .vm:
+//   // jackc-bundle 1
+//   // classes <число>
+//   // class <имя> <смещение> <размер> <число функций>   - по строке на класс
+//   // end
+// Смещение и размер раздела класса - в байтах от начала файла,
+// записаны фиксированной ширины. Классы упорядочены по имени.
+
+// Проход по всей программе перед записью бандла
+using LinkPass = std::function<void(std::vector<CompiledClass>& classes)>;
+
+// Выполняет проходы и собирает текст бандла (нужны CompiledClass::functions)
+std::string linkBundle(std::vector<CompiledClass> classes, const std::vector<LinkPass>& passes = {});
+
+// Записывает бандл одной последовательной записью
+void writeBundle(const std::filesystem::path& path, const std::string& bundle);
@@ -0,0 +1,292 @@
+﻿#include "VMBytecode.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+const char MAGIC[4] = { 'J', 'V', 'B', '1' };
+
+const uint8_t PUSH_CODE = 0x00;
+const uint8_t POP_CODE = 0x10;
+const uint8_t OTHER_CODE = 0x20;
+const uint8_t SUPER_CODE = 0x30;
+
+// Результат замеров, чтобы разбор не был выброшен оптимизатором
+volatile size_t benchmarkSink = 0;
+
+void putVarint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void putNumber(std::string& out, int value) {
+    if (value < 0) {
+        throw std::runtime_error("Negative operand in VM code: " + std::to_string(value));
+    }
+    putVarint(out, static_cast<uint64_t>(value));
+}
+
+// Таблица строк: индекс в порядке первого появления
+class StringTable {
+public:
+    uint64_t index(const std::string& name) {
+        auto [it, added] = indices.emplace(name, strings.size());
+        if (added) strings.push_back(&it->first);
+        return it->second;
+    }
+
+    void write(std::string& out) const {
+        putVarint(out, strings.size());
+        for (const std::string* name : strings) {
+            putVarint(out, name->size());
+            out += *name;
+        }
+    }
+
+private:
+    std::unordered_map<std::string, uint64_t> indices;
+    std::vector<const std::string*> strings;
+};
+
+class Reader {
+public:
+    explicit Reader(std::string_view d) : data(d) {}
+
+    bool atEnd() const { return position == data.size(); }
+
+    uint8_t byte() {
+        if (position >= data.size()) fail("unexpected end of data");
+        return static_cast<uint8_t>(data[position++]);
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = byte();
+            value |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return value;
+        }
+        fail("varint is too long");
+    }
+
+    int number() {
+        uint64_t value = varint();
+        if (value > INT32_MAX) fail("operand is out of range");
+        return static_cast<int>(value);
+    }
+
+    // Количество элементов, каждый из которых занимает хотя бы байт
+    size_t count() {
+        uint64_t value = varint();
+        if (value > data.size() - position) fail("count exceeds data size");
+        return static_cast<size_t>(value);
+    }
+
+    std::string_view bytes(size_t length) {
+        if (length > data.size() - position) fail("unexpected end of data");
+        std::string_view result = data.substr(position, length);
+        position += length;
+        return result;
+    }
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error("Invalid bytecode at offset " + std::to_string(position) + ": " + message);
+    }
+
+private:
+    std::string_view data;
+    size_t position = 0;
+};
+
+}
+
+std::string encodeBytecode(const std::vector<VMFunction>& functions) {
+    StringTable strings;
+    std::string code;
+    putVarint(code, functions.size());
+    for (const auto& function : functions) {
+        putVarint(code, strings.index(function.name));
+        putNumber(code, function.nLocals);
+        putVarint(code, static_cast<uint64_t>(std::count_if(function.body.begin(), function.body.end(),
+            [](const VMInstruction& instruction) { return instruction.op != VMOp::NOP; })));
+
+        for (const auto& instruction : function.body) {
+            switch (instruction.op) {
+            case VMOp::NOP:
+                break;
+            case VMOp::PUSH:
+            case VMOp::POP:
+                if (instruction.segment == Segment::NONE) {
+                    throw std::runtime_error("Invalid segment");
+                }
+                code.push_back(static_cast<char>((instruction.op == VMOp::PUSH ? PUSH_CODE : POP_CODE) |
+                    static_cast<uint8_t>(instruction.segment)));
+                putNumber(code, instruction.index);
+                break;
+            case VMOp::INC:
+            case VMOp::DEC:
+            case VMOp::IF_EQ:
+            case VMOp::IF_NE:
+            case VMOp::IF_LT:
+            case VMOp::IF_GT:
+            case VMOp::IF_LE:
+            case VMOp::IF_GE:
+            case VMOp::LOAD:
+            case VMOp::STORE:
+                code.push_back(static_cast<char>(SUPER_CODE |
+                    (static_cast<uint8_t>(instruction.op) - static_cast<uint8_t>(VMOp::INC))));
+                if (instruction.op == VMOp::INC || instruction.op == VMOp::DEC) {
+                    if (instruction.segment == Segment::NONE) {
+                        throw std::runtime_error("Invalid segment");
+                    }
+                    putVarint(code, static_cast<uint8_t>(instruction.segment));
+                    putNumber(code, instruction.index);
+                }
+                else if (instruction.op != VMOp::LOAD && instruction.op != VMOp::STORE) {
+                    putVarint(code, strings.index(instruction.name));
+                }
+                break;
+            default:
+                code.push_back(static_cast<char>(OTHER_CODE |
+                    (static_cast<uint8_t>(instruction.op) - static_cast<uint8_t>(VMOp::ADD))));
+                if (instruction.op == VMOp::LABEL || instruction.op == VMOp::GOTO ||
+                    instruction.op == VMOp::IF_GOTO) {
+                    putVarint(code, strings.index(instruction.name));
+                }
+                else if (instruction.op == VMOp::CALL || instruction.op == VMOp::FUNCTION) {
+                    putVarint(code, strings.index(instruction.name));
+                    putNumber(code, instruction.index);
+                }
+            }
+        }
+    }
+
+    std::string result(MAGIC, sizeof(MAGIC));
+    strings.write(result);
+    return result + code;
+}
+
+std::vector<VMFunction> decodeBytecode(std::string_view data) {
+    Reader reader(data);
+    if (reader.bytes(sizeof(MAGIC)) != std::string_view(MAGIC, sizeof(MAGIC))) {
+        reader.fail("bad signature");
+    }
+
+    std::vector<std::string> strings(reader.count());
+    for (auto& name : strings) {
+        name = reader.bytes(reader.count());
+    }
+    auto name = [&]() -> const std::string& {
+        uint64_t index = reader.varint();
+        if (index >= strings.size()) reader.fail("string index is out of range");
+        return strings[index];
+    };
+
+    std::vector<VMFunction> functions(reader.count());
+    for (auto& function : functions) {
+        function.name = name();
+        function.nLocals = reader.number();
+        function.body.resize(reader.count());
+        for (auto& instruction : function.body) {
+            uint8_t code = reader.byte();
+            uint8_t low = code & 0x0F;
+            switch (code & 0xF0) {
+            case PUSH_CODE:
+            case POP_CODE:
+                if (low >= static_cast<uint8_t>(Segment::NONE)) reader.fail("bad segment");
+                instruction.op = (code & 0xF0) == PUSH_CODE ? VMOp::PUSH : VMOp::POP;
+                instruction.segment = static_cast<Segment>(low);
+                instruction.index = reader.number();
+                break;
+            case OTHER_CODE:
+                if (low > static_cast<uint8_t>(VMOp::RETURN) - static_cast<uint8_t>(VMOp::ADD)) reader.fail("bad opcode");
+                instruction.op = static_cast<VMOp>(low + static_cast<uint8_t>(VMOp::ADD));
+                if (instruction.op == VMOp::LABEL || instruction.op == VMOp::GOTO ||
+                    instruction.op == VMOp::IF_GOTO) {
+                    instruction.name = name();
+                }
+                else if (instruction.op == VMOp::CALL || instruction.op == VMOp::FUNCTION) {
+                    instruction.name = name();
+                    instruction.index = reader.number();
+                }
+                break;
+            case SUPER_CODE:
+                if (low > static_cast<uint8_t>(VMOp::STORE) - static_cast<uint8_t>(VMOp::INC)) reader.fail("bad opcode");
+                instruction.op = static_cast<VMOp>(low + static_cast<uint8_t>(VMOp::INC));
+                if (instruction.op == VMOp::INC || instruction.op == VMOp::DEC) {
+                    uint64_t segment = reader.varint();
+                    if (segment >= static_cast<uint8_t>(Segment::NONE)) reader.fail("bad segment");
+                    instruction.segment = static_cast<Segment>(segment);
+                    instruction.index = reader.number();
+                }
+                else if (instruction.op != VMOp::LOAD && instruction.op != VMOp::STORE) {
+                    instruction.name = name();
+                }
+                break;
+            default:
+                reader.fail("bad opcode");
+            }
+        }
+    }
+    if (!reader.atEnd()) {
+        reader.fail("trailing data");
+    }
+    return functions;
+}
+
+void benchmarkBytecode(const std::vector<std::string>& vmTexts, std::ostream& out) {
+    std::vector<std::string> encoded;
+    size_t textBytes = 0;
+    size_t binaryBytes = 0;
+    size_t instructions = 0;
+    for (const auto& text : vmTexts) {
+        std::vector<VMFunction> functions = parseFunctionsText(text);
+        for (const auto& function : functions) {
+            instructions += function.body.size() + 1;
+        }
+        encoded.push_back(encodeBytecode(functions));
+        textBytes += text.size();
+        binaryBytes += encoded.back().size();
+
+        if (decodeBytecode(encoded.back()).size() != functions.size()) {
+            throw std::runtime_error("Bytecode round trip failed");
+        }
+    }
+
+    // Повторяем разбор всего набора, пока не наберётся достаточное время
+    auto measure = [&](auto parse) {
+        using Clock = std::chrono::steady_clock;
+        size_t rounds = 0;
+        size_t functions = 0;
+        auto start = Clock::now();
+        double seconds = 0;
+        do {
+            for (size_t i = 0; i < vmTexts.size(); i++) {
+                functions += parse(i).size();
+            }
+            rounds++;
+            seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        } while (seconds < 0.5);
+        benchmarkSink = functions;
+        return seconds / rounds;
+    };
+    double textSeconds = measure([&](size_t i) { return parseFunctionsText(vmTexts[i]); });
+    double binarySeconds = measure([&](size_t i) { return decodeBytecode(encoded[i]); });
+
+    auto report = [&](const char* name, size_t bytes, double seconds) {
+        out << name << bytes << " bytes, parse " << seconds * 1000 << " ms ("
+            << bytes / seconds / (1024 * 1024) << " MiB/s, "
+            << static_cast<size_t>(instructions / seconds) << " commands/s)\n";
+    };
+    out << "Files: " << vmTexts.size() << ", " << instructions << " command(s)\n";
+    report("Text:     ", textBytes, textSeconds);
+    report("Bytecode: ", binaryBytes, binarySeconds);
+    out << "Size ratio " << static_cast<double>(binaryBytes) / std::max<size_t>(textBytes, 1)
+        << ", parse speedup " << textSeconds / std::max(binarySeconds, 1e-12) << "x\n";
+}
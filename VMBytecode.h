@@ -0,0 +1,26 @@
+﻿#pragma once
+#include "VMInstruction.h"
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Двоичный формат VM-кода (.vmb), компактнее и быстрее текста при разборе.
+// Числа - беззнаковые varint (LEB128), имена - индексы в таблице строк.
+//   "JVB1"
+//   <число строк> { <длина> <байты> }          - имена функций и меток
+//   <число функций> { <имя> <локальных> <число команд> <команды> }
+// Команда - байт кода и операнды:
+//   0x0s push <сегмент s> <индекс>     0x1s pop <сегмент s> <индекс>
+//   0x2k прочие команды (k = op - ADD): label/goto/if-goto <имя>,
+//        call/function <имя> <число>, остальные без операндов
+//   0x3k суперкоманды (k = op - INC): inc/dec <сегмент> <индекс>,
+//        if-eq ... if-ge <имя>, load и store без операндов
+std::string encodeBytecode(const std::vector<VMFunction>& functions);
+
+// Разбор .vmb; при повреждённых данных - исключение
+std::vector<VMFunction> decodeBytecode(std::string_view data);
+
+// Сравнение размера и скорости разбора текстового и двоичного формата
+// на наборе текстов .vm
+void benchmarkBytecode(const std::vector<std::string>& vmTexts, std::ostream& out);
@@ -0,0 +1,229 @@
+﻿#include "VMInstruction.h"
+#include <charconv>
+#include <stdexcept>
+#include <unordered_map>
+
+Segment segmentFromString(const std::string& segment) {
+    static const std::unordered_map<std::string, Segment> map = {
+        {"constant", Segment::CONSTANT}, {"argument", Segment::ARGUMENT},
+        {"local", Segment::LOCAL}, {"static", Segment::STATIC},
+        {"this", Segment::THIS}, {"that", Segment::THAT},
+        {"pointer", Segment::POINTER}, {"temp", Segment::TEMP}
+    };
+
+    auto it = map.find(segment);
+    if (it == map.end()) {
+        throw std::runtime_error("Unknown segment: " + segment);
+    }
+    return it->second;
+}
+
+std::string segmentToString(Segment segment) {
+    switch (segment) {
+    case Segment::CONSTANT: return "constant";
+    case Segment::ARGUMENT: return "argument";
+    case Segment::LOCAL:    return "local";
+    case Segment::STATIC:   return "static";
+    case Segment::THIS:     return "this";
+    case Segment::THAT:     return "that";
+    case Segment::POINTER:  return "pointer";
+    case Segment::TEMP:     return "temp";
+    default:
+        throw std::runtime_error("Invalid segment");
+    }
+}
+
+VMOp arithmeticFromString(const std::string& command) {
+    static const std::unordered_map<std::string, VMOp> map = {
+        {"add", VMOp::ADD}, {"sub", VMOp::SUB}, {"neg", VMOp::NEG},
+        {"eq", VMOp::EQ}, {"gt", VMOp::GT}, {"lt", VMOp::LT},
+        {"and", VMOp::AND}, {"or", VMOp::OR}, {"not", VMOp::NOT}
+    };
+
+    auto it = map.find(command);
+    if (it == map.end()) {
+        throw std::runtime_error("Unknown arithmetic command: " + command);
+    }
+    return it->second;
+}
+
+std::string opToString(VMOp op) {
+    switch (op) {
+    case VMOp::PUSH:     return "push";
+    case VMOp::POP:      return "pop";
+    case VMOp::ADD:      return "add";
+    case VMOp::SUB:      return "sub";
+    case VMOp::NEG:      return "neg";
+    case VMOp::EQ:       return "eq";
+    case VMOp::GT:       return "gt";
+    case VMOp::LT:       return "lt";
+    case VMOp::AND:      return "and";
+    case VMOp::OR:       return "or";
+    case VMOp::NOT:      return "not";
+    case VMOp::LABEL:    return "label";
+    case VMOp::GOTO:     return "goto";
+    case VMOp::IF_GOTO:  return "if-goto";
+    case VMOp::FUNCTION: return "function";
+    case VMOp::CALL:     return "call";
+    case VMOp::RETURN:   return "return";
+    case VMOp::INC:      return "inc";
+    case VMOp::DEC:      return "dec";
+    case VMOp::IF_EQ:    return "if-eq";
+    case VMOp::IF_NE:    return "if-ne";
+    case VMOp::IF_LT:    return "if-lt";
+    case VMOp::IF_GT:    return "if-gt";
+    case VMOp::IF_LE:    return "if-le";
+    case VMOp::IF_GE:    return "if-ge";
+    case VMOp::LOAD:     return "load";
+    case VMOp::STORE:    return "store";
+    default:
+        throw std::runtime_error("Invalid VM command");
+    }
+}
+
+bool isArithmetic(VMOp op) {
+    return op >= VMOp::ADD && op <= VMOp::NOT;
+}
+
+bool isSuperinstruction(VMOp op) {
+    return op >= VMOp::INC && op <= VMOp::STORE;
+}
+
+namespace {
+
+// Сравнение и переход ("if-lt", ...)
+VMOp conditionalJumpFromString(std::string_view command) {
+    static const std::unordered_map<std::string_view, VMOp> map = {
+        {"if-eq", VMOp::IF_EQ}, {"if-ne", VMOp::IF_NE}, {"if-lt", VMOp::IF_LT},
+        {"if-gt", VMOp::IF_GT}, {"if-le", VMOp::IF_LE}, {"if-ge", VMOp::IF_GE}
+    };
+
+    auto it = map.find(command);
+    return it != map.end() ? it->second : VMOp::NOP;
+}
+
+}
+
+// Текстовое представление одной команды
+void writeInstructionText(std::ostream& out, const VMInstruction& instruction) {
+    switch (instruction.op) {
+    case VMOp::PUSH:
+    case VMOp::POP:
+    case VMOp::INC:
+    case VMOp::DEC:
+        out << opToString(instruction.op) << " "
+            << segmentToString(instruction.segment) << " " << instruction.index << "\n";
+        break;
+    case VMOp::LABEL:
+    case VMOp::GOTO:
+    case VMOp::IF_GOTO:
+    case VMOp::IF_EQ:
+    case VMOp::IF_NE:
+    case VMOp::IF_LT:
+    case VMOp::IF_GT:
+    case VMOp::IF_LE:
+    case VMOp::IF_GE:
+        out << opToString(instruction.op) << " " << instruction.name << "\n";
+        break;
+    case VMOp::CALL:
+    case VMOp::FUNCTION:
+        out << opToString(instruction.op) << " "
+            << instruction.name << " " << instruction.index << "\n";
+        break;
+    case VMOp::NOP:
+        break;
+    default:
+        out << opToString(instruction.op) << "\n";
+    }
+}
+
+void writeFunctionText(std::ostream& out, const VMFunction& function) {
+    out << "function " << function.name << " " << function.nLocals << "\n";
+    for (const auto& instruction : function.body) {
+        writeInstructionText(out, instruction);
+    }
+}
+
+namespace {
+
+// Следующее слово строки (разделители - пробелы и табуляция)
+std::string_view nextWord(std::string_view& line) {
+    size_t start = line.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) {
+        line = {};
+        return {};
+    }
+    size_t end = line.find_first_of(" \t\r", start);
+    if (end == std::string_view::npos) end = line.size();
+    std::string_view word = line.substr(start, end - start);
+    line.remove_prefix(end);
+    return word;
+}
+
+int parseNumber(std::string_view word, size_t lineNumber) {
+    int value = 0;
+    auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+    if (error != std::errc() || end != word.data() + word.size()) {
+        throw std::runtime_error("Invalid number at line " + std::to_string(lineNumber) + ": " + std::string(word));
+    }
+    return value;
+}
+
+}
+
+std::vector<VMFunction> parseFunctionsText(std::string_view text) {
+    std::vector<VMFunction> functions;
+    size_t lineNumber = 0;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        lineNumber++;
+
+        size_t comment = line.find("//");
+        if (comment != std::string_view::npos) line = line.substr(0, comment);
+        std::string_view command = nextWord(line);
+        if (command.empty()) continue;
+
+        if (command == "function") {
+            VMFunction function;
+            function.name = nextWord(line);
+            function.nLocals = parseNumber(nextWord(line), lineNumber);
+            functions.push_back(std::move(function));
+            continue;
+        }
+        if (functions.empty()) {
+            throw std::runtime_error("Command outside of a function at line " + std::to_string(lineNumber));
+        }
+
+        VMInstruction instruction{ VMOp::RETURN };
+        VMOp jump = conditionalJumpFromString(command);
+        if (command == "push" || command == "pop" || command == "inc" || command == "dec") {
+            instruction.op = command == "push" ? VMOp::PUSH : command == "pop" ? VMOp::POP :
+                command == "inc" ? VMOp::INC : VMOp::DEC;
+            instruction.segment = segmentFromString(std::string(nextWord(line)));
+            instruction.index = parseNumber(nextWord(line), lineNumber);
+        }
+        else if (command == "label" || command == "goto" || command == "if-goto") {
+            instruction.op = command == "label" ? VMOp::LABEL : command == "goto" ? VMOp::GOTO : VMOp::IF_GOTO;
+            instruction.name = nextWord(line);
+        }
+        else if (jump != VMOp::NOP) {
+            instruction.op = jump;
+            instruction.name = nextWord(line);
+        }
+        else if (command == "load" || command == "store") {
+            instruction.op = command == "load" ? VMOp::LOAD : VMOp::STORE;
+        }
+        else if (command == "call") {
+            instruction.op = VMOp::CALL;
+            instruction.name = nextWord(line);
+            instruction.index = parseNumber(nextWord(line), lineNumber);
+        }
+        else if (command != "return") {
+            instruction.op = arithmeticFromString(std::string(command));
+        }
+        functions.back().body.push_back(std::move(instruction));
+    }
+    return functions;
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Команды VM
+enum class VMOp {
+    PUSH, POP,
+    ADD, SUB, NEG, EQ, GT, LT, AND, OR, NOT,
+    LABEL, GOTO, IF_GOTO,
+    FUNCTION, CALL, RETURN,
+    // Суперкоманды расширенного диалекта (Superinstructions.h)
+    INC, DEC,                                   // inc/dec local i
+    IF_EQ, IF_NE, IF_LT, IF_GT, IF_LE, IF_GE,   // Сравнение и переход: if-lt L
+    LOAD, STORE,                                // Чтение и запись элемента массива
+    NOP // Точка сохранения значения для CSE, в файл не записывается
+};
+
+// Сегменты памяти VM
+enum class Segment {
+    CONSTANT, ARGUMENT, LOCAL, STATIC,
+    THIS, THAT, POINTER, TEMP, NONE
+};
+
+// Одна команда VM
+struct VMInstruction {
+    VMOp op;
+    Segment segment = Segment::NONE;
+    int index = 0;       // Индекс сегмента, число аргументов или локальных
+    std::string name;    // Метка или имя функции
+    uint32_t line = 0;   // Строка исходника Jack (0 - неизвестна), в .vm не пишется
+
+    // Строка исходника в сравнении не участвует
+    bool operator==(const VMInstruction& other) const {
+        return op == other.op && segment == other.segment && index == other.index && name == other.name;
+    }
+};
+
+// Буфер одной функции: заголовок и тело
+struct VMFunction {
+    std::string name;
+    int nLocals = 0;
+    std::vector<VMInstruction> body;
+};
+
+Segment segmentFromString(const std::string& segment);
+std::string segmentToString(Segment segment);
+
+// Арифметические/логические команды ("add", "not", ...)
+VMOp arithmeticFromString(const std::string& command);
+std::string opToString(VMOp op);
+bool isArithmetic(VMOp op);
+bool isSuperinstruction(VMOp op);
+
+// Текстовое представление команды и функции (заголовок и тело) в формате .vm
+void writeInstructionText(std::ostream& out, const VMInstruction& instruction);
+void writeFunctionText(std::ostream& out, const VMFunction& function);
+
+// Разбор текста .vm обратно в функции. Комментарии // и пустые строки
+// пропускаются; команда вне функции - ошибка.
+std::vector<VMFunction> parseFunctionsText(std::string_view text);
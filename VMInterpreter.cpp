@@ -0,0 +1,611 @@
+﻿#include "VMInterpreter.h"
+#include "CodeGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+
+#if defined(__GNUC__) || defined(__clang__)
+#define JACKC_COMPUTED_GOTO 1
+#endif
+
+namespace {
+
+// Раскладка памяти Hack
+const int TEMP_BASE = 5;
+const int TEMP_SIZE = 8;
+const int STATIC_BASE = 16;
+const int STATIC_END = 256;
+const int STACK_BASE = 256;
+const int STACK_END = 2048;
+// Слова, которые call кладёт в стек Hack: адрес возврата, LCL, ARG, THIS, THAT.
+// Кадры хранятся отдельно, но место в стеке они должны занимать.
+const int CALL_FRAME_SIZE = 5;
+const int HEAP_END = 16384;
+const int RAM_SIZE = 32768;
+const int ADDRESS_MASK = RAM_SIZE - 1;
+
+// Команды декодированного кода: сегмент и вид адреса выбраны заранее
+#define VM_OPCODES(X) \
+    X(PUSH_CONSTANT) X(PUSH_LOCAL) X(PUSH_ARGUMENT) X(PUSH_THIS) X(PUSH_THAT) \
+    X(PUSH_ADDRESS) X(PUSH_THIS_POINTER) X(PUSH_THAT_POINTER) \
+    X(POP_LOCAL) X(POP_ARGUMENT) X(POP_THIS) X(POP_THAT) \
+    X(POP_ADDRESS) X(POP_THIS_POINTER) X(POP_THAT_POINTER) \
+    X(ADD) X(SUB) X(NEG) X(EQ) X(GT) X(LT) X(AND) X(OR) X(NOT) \
+    X(GOTO) X(IF_GOTO) X(CALL) X(CALL_NATIVE) X(FUNCTION) X(RETURN) X(PROFILE) \
+    X(INC_LOCAL) X(IF_EQ) X(IF_NE) X(IF_LT) X(IF_GT) X(IF_LE) X(IF_GE) X(LOAD) X(STORE)
+
+enum class Op : uint8_t {
+#define OPCODE_ENUM(name) name,
+    VM_OPCODES(OPCODE_ENUM)
+#undef OPCODE_ENUM
+};
+
+// Встроенные функции ОС: имя и число аргументов (у методов - вместе с this)
+#define OS_FUNCTIONS(X) \
+    X(MATH_INIT, "Math.init", 0) X(MATH_ABS, "Math.abs", 1) X(MATH_MULTIPLY, "Math.multiply", 2) \
+    X(MATH_DIVIDE, "Math.divide", 2) X(MATH_MIN, "Math.min", 2) X(MATH_MAX, "Math.max", 2) \
+    X(MATH_SQRT, "Math.sqrt", 1) \
+    X(MEMORY_INIT, "Memory.init", 0) X(MEMORY_PEEK, "Memory.peek", 1) X(MEMORY_POKE, "Memory.poke", 2) \
+    X(MEMORY_ALLOC, "Memory.alloc", 1) X(MEMORY_DEALLOC, "Memory.deAlloc", 1) \
+    X(ARRAY_NEW, "Array.new", 1) X(ARRAY_DISPOSE, "Array.dispose", 1) \
+    X(STRING_NEW, "String.new", 1) X(STRING_DISPOSE, "String.dispose", 1) \
+    X(STRING_LENGTH, "String.length", 1) X(STRING_CHAR_AT, "String.charAt", 2) \
+    X(STRING_SET_CHAR_AT, "String.setCharAt", 3) X(STRING_APPEND_CHAR, "String.appendChar", 2) \
+    X(STRING_ERASE_LAST_CHAR, "String.eraseLastChar", 1) X(STRING_INT_VALUE, "String.intValue", 1) \
+    X(STRING_SET_INT, "String.setInt", 2) X(STRING_BACKSPACE, "String.backSpace", 0) \
+    X(STRING_DOUBLE_QUOTE, "String.doubleQuote", 0) X(STRING_NEWLINE, "String.newLine", 0) \
+    X(OUTPUT_INIT, "Output.init", 0) X(OUTPUT_MOVE_CURSOR, "Output.moveCursor", 2) \
+    X(OUTPUT_PRINT_CHAR, "Output.printChar", 1) X(OUTPUT_PRINT_STRING, "Output.printString", 1) \
+    X(OUTPUT_PRINT_INT, "Output.printInt", 1) X(OUTPUT_PRINTLN, "Output.println", 0) \
+    X(OUTPUT_BACKSPACE, "Output.backSpace", 0) \
+    X(SCREEN_INIT, "Screen.init", 0) X(SCREEN_CLEAR, "Screen.clearScreen", 0) \
+    X(SCREEN_SET_COLOR, "Screen.setColor", 1) X(SCREEN_DRAW_PIXEL, "Screen.drawPixel", 2) \
+    X(SCREEN_DRAW_LINE, "Screen.drawLine", 4) X(SCREEN_DRAW_RECTANGLE, "Screen.drawRectangle", 4) \
+    X(SCREEN_DRAW_CIRCLE, "Screen.drawCircle", 3) \
+    X(KEYBOARD_INIT, "Keyboard.init", 0) X(KEYBOARD_KEY_PRESSED, "Keyboard.keyPressed", 0) \
+    X(KEYBOARD_READ_CHAR, "Keyboard.readChar", 0) X(KEYBOARD_READ_LINE, "Keyboard.readLine", 1) \
+    X(KEYBOARD_READ_INT, "Keyboard.readInt", 1) \
+    X(SYS_HALT, "Sys.halt", 0) X(SYS_ERROR, "Sys.error", 1) X(SYS_WAIT, "Sys.wait", 1)
+
+enum Native {
+#define NATIVE_ENUM(id, name, arity) id,
+    OS_FUNCTIONS(NATIVE_ENUM)
+#undef NATIVE_ENUM
+};
+
+struct NativeFunction {
+    Native id;
+    int arity;
+};
+
+const std::unordered_map<std::string_view, NativeFunction>& nativeFunctions() {
+    static const std::unordered_map<std::string_view, NativeFunction> functions = {
+#define NATIVE_ENTRY(id, name, arity) { name, { id, arity } },
+        OS_FUNCTIONS(NATIVE_ENTRY)
+#undef NATIVE_ENTRY
+    };
+    return functions;
+}
+
+// Коды символов Jack
+const int NEWLINE = 128;
+const int BACKSPACE = 129;
+const int DOUBLE_QUOTE = 34;
+
+// Строка в куче: [максимальная длина, длина, символы...]
+const int STRING_HEADER = 2;
+
+// Счётчик инструментированного кода (CompilerOptions::instrument)
+const char* const PROFILE_COUNT = "Profile.count";
+
+}
+
+struct VMInterpreter::Code {
+    Op op;
+    int32_t a = 0;      // Значение, адрес, смещение, цель перехода или число локальных
+    int32_t b = 0;      // Число аргументов вызова или приращение inc/dec
+};
+
+struct VMInterpreter::Frame {
+    const Code* returnTo;
+    int lcl;
+    int arg;
+    int thisBase;
+    int thatBase;
+};
+
+VMInterpreter::VMInterpreter() = default;
+VMInterpreter::~VMInterpreter() = default;
+
+void VMInterpreter::load(std::vector<VMFunction> functions) {
+    for (auto& function : functions) {
+        std::string className = function.name.substr(0, function.name.find('.'));
+        classes[className].push_back(std::move(function));
+    }
+}
+
+void VMInterpreter::setInstructionLimit(uint64_t limit) {
+    instructionLimit = limit;
+}
+
+// Декодирование: метки превращаются в индексы команд, вызовы - в адрес
+// функции или номер встроенной функции, static и temp - в адреса RAM
+void VMInterpreter::link() {
+    code.clear();
+    entries.clear();
+
+    struct PendingCall {
+        size_t index;
+        std::string name;
+        int32_t classIndex;
+    };
+    std::vector<PendingCall> calls;
+    int staticBase = STATIC_BASE;
+    profiledClasses.clear();
+
+    for (const auto& [className, functions] : classes) {
+        int32_t classIndex = static_cast<int32_t>(profiledClasses.size());
+        profiledClasses.push_back(className);
+        int staticCount = 0;
+        for (const auto& function : functions) {
+            if (!entries.emplace(function.name, static_cast<uint32_t>(code.size())).second) {
+                throw std::runtime_error("Duplicate function: " + function.name);
+            }
+
+            // Метка указывает на следующую за ней команду
+            std::unordered_map<std::string, int32_t> labels;
+            int32_t position = static_cast<int32_t>(code.size()) + 1;
+            for (const auto& instruction : function.body) {
+                if (instruction.op == VMOp::LABEL) {
+                    labels[instruction.name] = position;
+                }
+                else if (instruction.op != VMOp::NOP) {
+                    position++;
+                }
+            }
+            auto label = [&](const std::string& name) {
+                auto it = labels.find(name);
+                if (it == labels.end()) {
+                    throw std::runtime_error("Undefined label " + name + " in " + function.name);
+                }
+                return it->second;
+            };
+
+            code.push_back({ Op::FUNCTION, function.nLocals });
+            for (const auto& instruction : function.body) {
+                int index = instruction.index;
+                switch (instruction.op) {
+                case VMOp::PUSH:
+                case VMOp::POP: {
+                    bool push = instruction.op == VMOp::PUSH;
+                    switch (instruction.segment) {
+                    case Segment::CONSTANT:
+                        if (!push) throw std::runtime_error("Cannot pop to constant in " + function.name);
+                        code.push_back({ Op::PUSH_CONSTANT, index });
+                        break;
+                    case Segment::LOCAL:    code.push_back({ push ? Op::PUSH_LOCAL : Op::POP_LOCAL, index }); break;
+                    case Segment::ARGUMENT: code.push_back({ push ? Op::PUSH_ARGUMENT : Op::POP_ARGUMENT, index }); break;
+                    case Segment::THIS:     code.push_back({ push ? Op::PUSH_THIS : Op::POP_THIS, index }); break;
+                    case Segment::THAT:     code.push_back({ push ? Op::PUSH_THAT : Op::POP_THAT, index }); break;
+                    case Segment::POINTER:
+                        if (index == 0) code.push_back({ push ? Op::PUSH_THIS_POINTER : Op::POP_THIS_POINTER });
+                        else if (index == 1) code.push_back({ push ? Op::PUSH_THAT_POINTER : Op::POP_THAT_POINTER });
+                        else throw std::runtime_error("Invalid pointer index in " + function.name);
+                        break;
+                    case Segment::TEMP:
+                        if (index < 0 || index >= TEMP_SIZE) {
+                            throw std::runtime_error("Invalid temp index in " + function.name);
+                        }
+                        code.push_back({ push ? Op::PUSH_ADDRESS : Op::POP_ADDRESS, TEMP_BASE + index });
+                        break;
+                    case Segment::STATIC:
+                        if (index < 0 || staticBase + index >= STATIC_END) {
+                            throw std::runtime_error("Too many static variables in class " + className);
+                        }
+                        staticCount = std::max(staticCount, index + 1);
+                        code.push_back({ push ? Op::PUSH_ADDRESS : Op::POP_ADDRESS, staticBase + index });
+                        break;
+                    default:
+                        throw std::runtime_error("Invalid segment in " + function.name);
+                    }
+                    break;
+                }
+                case VMOp::ADD: code.push_back({ Op::ADD }); break;
+                case VMOp::SUB: code.push_back({ Op::SUB }); break;
+                case VMOp::NEG: code.push_back({ Op::NEG }); break;
+                case VMOp::EQ:  code.push_back({ Op::EQ }); break;
+                case VMOp::GT:  code.push_back({ Op::GT }); break;
+                case VMOp::LT:  code.push_back({ Op::LT }); break;
+                case VMOp::AND: code.push_back({ Op::AND }); break;
+                case VMOp::OR:  code.push_back({ Op::OR }); break;
+                case VMOp::NOT: code.push_back({ Op::NOT }); break;
+                case VMOp::GOTO:    code.push_back({ Op::GOTO, label(instruction.name) }); break;
+                case VMOp::IF_GOTO: code.push_back({ Op::IF_GOTO, label(instruction.name) }); break;
+                case VMOp::CALL:
+                    calls.push_back({ code.size(), instruction.name, classIndex });
+                    code.push_back({ Op::CALL, 0, index });
+                    break;
+                case VMOp::RETURN: code.push_back({ Op::RETURN }); break;
+                case VMOp::INC:
+                case VMOp::DEC:
+                    if (instruction.segment != Segment::LOCAL) {
+                        throw std::runtime_error("Invalid segment in " + function.name);
+                    }
+                    code.push_back({ Op::INC_LOCAL, index, instruction.op == VMOp::INC ? 1 : -1 });
+                    break;
+                case VMOp::IF_EQ: code.push_back({ Op::IF_EQ, label(instruction.name) }); break;
+                case VMOp::IF_NE: code.push_back({ Op::IF_NE, label(instruction.name) }); break;
+                case VMOp::IF_LT: code.push_back({ Op::IF_LT, label(instruction.name) }); break;
+                case VMOp::IF_GT: code.push_back({ Op::IF_GT, label(instruction.name) }); break;
+                case VMOp::IF_LE: code.push_back({ Op::IF_LE, label(instruction.name) }); break;
+                case VMOp::IF_GE: code.push_back({ Op::IF_GE, label(instruction.name) }); break;
+                case VMOp::LOAD:  code.push_back({ Op::LOAD }); break;
+                case VMOp::STORE: code.push_back({ Op::STORE }); break;
+                case VMOp::LABEL:
+                case VMOp::NOP:
+                    break;
+                default:
+                    throw std::runtime_error("Unexpected command in " + function.name);
+                }
+            }
+        }
+        staticBase += staticCount;
+    }
+
+    // Загруженные функции важнее встроенных: можно исполнять и ОС в .vm
+    for (const auto& call : calls) {
+        Code& instruction = code[call.index];
+        auto entry = entries.find(call.name);
+        if (entry != entries.end()) {
+            instruction.a = static_cast<int32_t>(entry->second);
+            continue;
+        }
+        if (call.name == PROFILE_COUNT && instruction.b == 1) {
+            instruction.op = Op::PROFILE;
+            instruction.a = call.classIndex;
+            continue;
+        }
+        std::string_view className = std::string_view(call.name).substr(0, call.name.find('.'));
+        auto native = nativeFunctions().find(call.name);
+        if (!CodeGenerator::isBuiltInClass(className) || native == nativeFunctions().end()) {
+            throw std::runtime_error("Undefined function: " + call.name);
+        }
+        if (native->second.arity != instruction.b) {
+            throw std::runtime_error("Wrong number of arguments in call to " + call.name);
+        }
+        instruction.op = Op::CALL_NATIVE;
+        instruction.a = native->second.id;
+    }
+}
+
+VMInterpreter::Result VMInterpreter::run(std::ostream& output, std::istream* input) {
+    link();
+    auto entry = entries.find("Sys.init");
+    if (entry == entries.end()) entry = entries.find("Main.main");
+    if (entry == entries.end()) {
+        throw std::runtime_error("No entry point: Sys.init or Main.main");
+    }
+
+    ram.assign(RAM_SIZE, 0);
+    halted = false;
+    heapTop = STACK_END;
+    freeBlocks.clear();
+    profile.assign(profiledClasses.size(), {});
+
+    // Регистры виртуальной машины
+    int16_t* memory = ram.data();
+    const Code* base = code.data();
+    const Code* ip = base + entry->second;
+    int sp = STACK_BASE;
+    int lcl = sp;
+    int arg = sp;
+    int thisBase = 0;
+    int thatBase = 0;
+    std::vector<Frame> frames;
+
+    uint64_t executed = 0;
+    const uint64_t limit = instructionLimit != 0 ? instructionLimit : UINT64_MAX;
+    auto start = std::chrono::steady_clock::now();
+    int16_t x = 0;
+    int16_t y = 0;
+
+#define RAM(address) memory[(address) & ADDRESS_MASK]
+#define PUSH(value) (memory[sp++ & ADDRESS_MASK] = static_cast<int16_t>(value))
+#define POP() memory[--sp & ADDRESS_MASK]
+#define BINARY(expression) y = POP(); x = POP(); PUSH(expression); ip++; NEXT()
+#define COMPARE_JUMP(condition) CHECK_LIMIT(); y = POP(); x = POP(); ip = (condition) ? base + ip->a : ip + 1; NEXT()
+#define CHECK_LIMIT() do { if (executed > limit) goto limitReached; } while (0)
+
+#ifdef JACKC_COMPUTED_GOTO
+#define HANDLER_ADDRESS(name) &&op_##name,
+    static const void* const handlers[] = { VM_OPCODES(HANDLER_ADDRESS) };
+#undef HANDLER_ADDRESS
+#define NEXT() do { executed++; goto *handlers[static_cast<int>(ip->op)]; } while (0)
+#define HANDLER(name) op_##name:
+    NEXT();
+#else
+#define NEXT() continue
+#define HANDLER(name) case Op::name:
+    for (;;) {
+        executed++;
+        switch (ip->op) {
+#endif
+
+    HANDLER(PUSH_CONSTANT)     PUSH(ip->a); ip++; NEXT();
+    HANDLER(PUSH_LOCAL)        PUSH(RAM(lcl + ip->a)); ip++; NEXT();
+    HANDLER(PUSH_ARGUMENT)     PUSH(RAM(arg + ip->a)); ip++; NEXT();
+    HANDLER(PUSH_THIS)         PUSH(RAM(thisBase + ip->a)); ip++; NEXT();
+    HANDLER(PUSH_THAT)         PUSH(RAM(thatBase + ip->a)); ip++; NEXT();
+    HANDLER(PUSH_ADDRESS)      PUSH(memory[ip->a]); ip++; NEXT();
+    HANDLER(PUSH_THIS_POINTER) PUSH(thisBase); ip++; NEXT();
+    HANDLER(PUSH_THAT_POINTER) PUSH(thatBase); ip++; NEXT();
+    HANDLER(POP_LOCAL)         x = POP(); RAM(lcl + ip->a) = x; ip++; NEXT();
+    HANDLER(POP_ARGUMENT)      x = POP(); RAM(arg + ip->a) = x; ip++; NEXT();
+    HANDLER(POP_THIS)          x = POP(); RAM(thisBase + ip->a) = x; ip++; NEXT();
+    HANDLER(POP_THAT)          x = POP(); RAM(thatBase + ip->a) = x; ip++; NEXT();
+    HANDLER(POP_ADDRESS)       memory[ip->a] = POP(); ip++; NEXT();
+    HANDLER(POP_THIS_POINTER)  thisBase = POP(); ip++; NEXT();
+    HANDLER(POP_THAT_POINTER)  thatBase = POP(); ip++; NEXT();
+    HANDLER(ADD) BINARY(x + y);
+    HANDLER(SUB) BINARY(x - y);
+    HANDLER(EQ)  BINARY(x == y ? -1 : 0);
+    HANDLER(GT)  BINARY(x > y ? -1 : 0);
+    HANDLER(LT)  BINARY(x < y ? -1 : 0);
+    HANDLER(AND) BINARY(x & y);
+    HANDLER(OR)  BINARY(x | y);
+    HANDLER(NEG) x = POP(); PUSH(-x); ip++; NEXT();
+    HANDLER(NOT) x = POP(); PUSH(~x); ip++; NEXT();
+    HANDLER(GOTO)
+        CHECK_LIMIT();
+        ip = base + ip->a;
+        NEXT();
+    HANDLER(IF_GOTO)
+        CHECK_LIMIT();
+        ip = POP() != 0 ? base + ip->a : ip + 1;
+        NEXT();
+    HANDLER(CALL)
+        CHECK_LIMIT();
+        frames.push_back({ ip + 1, lcl, arg, thisBase, thatBase });
+        arg = sp - ip->b;
+        ip = base + ip->a;
+        NEXT();
+    HANDLER(CALL_NATIVE)
+        sp -= ip->b;
+        x = callNative(ip->a, &memory[sp & ADDRESS_MASK], output, input);
+        if (halted) goto finished;
+        PUSH(x);
+        ip++;
+        NEXT();
+    HANDLER(FUNCTION)
+        if (sp + ip->a + CALL_FRAME_SIZE * static_cast<int>(frames.size()) >= STACK_END) {
+            throw std::runtime_error("Stack overflow");
+        }
+        lcl = sp;
+        for (int i = 0; i < ip->a; i++) memory[sp++] = 0;
+        ip++;
+        NEXT();
+    HANDLER(RETURN)
+        x = POP();
+        RAM(arg) = x;
+        sp = arg + 1;
+        if (frames.empty()) goto finished;
+        ip = frames.back().returnTo;
+        lcl = frames.back().lcl;
+        arg = frames.back().arg;
+        thisBase = frames.back().thisBase;
+        thatBase = frames.back().thatBase;
+        frames.pop_back();
+        NEXT();
+    HANDLER(PROFILE) {
+        // Profile.count(номер) возвращает 0, как функция без значения
+        auto& counters = profile[ip->a];
+        size_t counter = static_cast<uint16_t>(POP());
+        if (counter >= counters.size()) counters.resize(counter + 1);
+        counters[counter]++;
+        PUSH(0);
+        ip++;
+        NEXT();
+    }
+    HANDLER(INC_LOCAL) RAM(lcl + ip->a) = static_cast<int16_t>(RAM(lcl + ip->a) + ip->b); ip++; NEXT();
+    HANDLER(IF_EQ) COMPARE_JUMP(x == y);
+    HANDLER(IF_NE) COMPARE_JUMP(x != y);
+    HANDLER(IF_LT) COMPARE_JUMP(x < y);
+    HANDLER(IF_GT) COMPARE_JUMP(x > y);
+    HANDLER(IF_LE) COMPARE_JUMP(x <= y);
+    HANDLER(IF_GE) COMPARE_JUMP(x >= y);
+    // Как pop pointer 1 и push that 0 (store - и temp 0)
+    HANDLER(LOAD)  thatBase = POP(); PUSH(RAM(thatBase)); ip++; NEXT();
+    HANDLER(STORE) y = POP(); thatBase = POP(); memory[TEMP_BASE] = y; RAM(thatBase) = y; ip++; NEXT();
+
+#ifndef JACKC_COMPUTED_GOTO
+        }
+    }
+#endif
+
+#undef RAM
+#undef PUSH
+#undef POP
+#undef BINARY
+#undef COMPARE_JUMP
+#undef CHECK_LIMIT
+#undef NEXT
+#undef HANDLER
+
+limitReached:
+    throw std::runtime_error("Instruction limit exceeded (" + std::to_string(limit) + ")");
+
+finished:
+    Result result;
+    result.instructions = executed;
+    result.returnValue = x;
+    result.halted = halted;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    output.flush();
+    return result;
+}
+
+std::map<std::string, std::vector<uint64_t>> VMInterpreter::profileCounts() const {
+    std::map<std::string, std::vector<uint64_t>> counts;
+    for (size_t i = 0; i < profile.size(); i++) {
+        if (!profile[i].empty()) counts[profiledClasses[i]] = profile[i];
+    }
+    return counts;
+}
+
+int16_t VMInterpreter::allocate(int size) {
+    if (size <= 0) {
+        throw std::runtime_error("Memory.alloc: size must be positive");
+    }
+    auto it = freeBlocks.find(size);
+    if (it != freeBlocks.end() && !it->second.empty()) {
+        int16_t address = it->second.back();
+        it->second.pop_back();
+        std::fill(ram.begin() + address, ram.begin() + address + size, 0);
+        return address;
+    }
+    if (heapTop + 1 + size > HEAP_END) {
+        throw std::runtime_error("Memory.alloc: heap overflow");
+    }
+    ram[heapTop] = static_cast<int16_t>(size);
+    int16_t address = static_cast<int16_t>(heapTop + 1);
+    heapTop += 1 + size;
+    return address;
+}
+
+void VMInterpreter::deallocate(int16_t address) {
+    if (address <= STACK_END || address >= heapTop) {
+        throw std::runtime_error("Memory.deAlloc: invalid address " + std::to_string(address));
+    }
+    freeBlocks[ram[address - 1]].push_back(address);
+}
+
+int16_t VMInterpreter::callNative(int native, int16_t* args, std::ostream& output, std::istream* input) {
+    auto at = [this](int address) -> int16_t& { return ram[address & ADDRESS_MASK]; };
+    auto checkString = [&](int16_t string, int index) {
+        if (index < 0 || index >= at(string + 1)) {
+            throw std::runtime_error("String index out of bounds");
+        }
+    };
+    auto newString = [&](const std::string& text) {
+        int16_t string = allocate(STRING_HEADER + static_cast<int>(text.size()));
+        at(string) = static_cast<int16_t>(text.size());
+        at(string + 1) = static_cast<int16_t>(text.size());
+        for (size_t i = 0; i < text.size(); i++) {
+            at(string + STRING_HEADER + static_cast<int>(i)) = static_cast<int16_t>(static_cast<unsigned char>(text[i]));
+        }
+        return string;
+    };
+    auto readLine = [&](int16_t message) {
+        for (int i = 0; i < at(message + 1); i++) {
+            output << static_cast<char>(at(message + STRING_HEADER + i));
+        }
+        std::string line;
+        if (input != nullptr) std::getline(*input, line);
+        return line;
+    };
+    auto printChar = [&](int c) {
+        if (c == NEWLINE) output << '\n';
+        else if (c != BACKSPACE) output << static_cast<char>(c);
+    };
+
+    switch (native) {
+    case MATH_ABS:      return static_cast<int16_t>(args[0] < 0 ? -args[0] : args[0]);
+    case MATH_MULTIPLY: return static_cast<int16_t>(args[0] * args[1]);
+    case MATH_DIVIDE:
+        if (args[1] == 0) throw std::runtime_error("Math.divide: division by zero");
+        return static_cast<int16_t>(args[0] / args[1]);
+    case MATH_MIN:      return std::min(args[0], args[1]);
+    case MATH_MAX:      return std::max(args[0], args[1]);
+    case MATH_SQRT:
+        if (args[0] < 0) throw std::runtime_error("Math.sqrt: negative argument");
+        return static_cast<int16_t>(std::sqrt(static_cast<double>(args[0])));
+
+    case MEMORY_PEEK:   return at(args[0]);
+    case MEMORY_POKE:   at(args[0]) = args[1]; return 0;
+    case MEMORY_ALLOC:
+    case ARRAY_NEW:     return allocate(args[0]);
+    case MEMORY_DEALLOC:
+    case ARRAY_DISPOSE:
+    case STRING_DISPOSE:
+        deallocate(args[0]);
+        return 0;
+
+    case STRING_NEW: {
+        if (args[0] < 0) throw std::runtime_error("String.new: negative length");
+        int16_t string = allocate(STRING_HEADER + args[0]);
+        at(string) = args[0];
+        at(string + 1) = 0;
+        return string;
+    }
+    case STRING_LENGTH:  return at(args[0] + 1);
+    case STRING_CHAR_AT:
+        checkString(args[0], args[1]);
+        return at(args[0] + STRING_HEADER + args[1]);
+    case STRING_SET_CHAR_AT:
+        checkString(args[0], args[1]);
+        at(args[0] + STRING_HEADER + args[1]) = args[2];
+        return 0;
+    case STRING_APPEND_CHAR:
+        if (at(args[0] + 1) >= at(args[0])) throw std::runtime_error("String.appendChar: string is full");
+        at(args[0] + STRING_HEADER + at(args[0] + 1)) = args[1];
+        at(args[0] + 1)++;
+        return args[0];
+    case STRING_ERASE_LAST_CHAR:
+        if (at(args[0] + 1) == 0) throw std::runtime_error("String.eraseLastChar: string is empty");
+        at(args[0] + 1)--;
+        return 0;
+    case STRING_INT_VALUE: {
+        int value = 0;
+        int i = 0;
+        int length = at(args[0] + 1);
+        bool negative = length > 0 && at(args[0] + STRING_HEADER) == '-';
+        for (i = negative ? 1 : 0; i < length; i++) {
+            int c = at(args[0] + STRING_HEADER + i);
+            if (c < '0' || c > '9') break;
+            value = value * 10 + (c - '0');
+        }
+        return static_cast<int16_t>(negative ? -value : value);
+    }
+    case STRING_SET_INT: {
+        std::string text = std::to_string(args[1]);
+        if (static_cast<int>(text.size()) > at(args[0])) throw std::runtime_error("String.setInt: string is too short");
+        for (size_t i = 0; i < text.size(); i++) {
+            at(args[0] + STRING_HEADER + static_cast<int>(i)) = static_cast<int16_t>(text[i]);
+        }
+        at(args[0] + 1) = static_cast<int16_t>(text.size());
+        return 0;
+    }
+    case STRING_BACKSPACE:    return BACKSPACE;
+    case STRING_DOUBLE_QUOTE: return DOUBLE_QUOTE;
+    case STRING_NEWLINE:      return NEWLINE;
+
+    case OUTPUT_PRINT_CHAR:   printChar(args[0]); return 0;
+    case OUTPUT_PRINT_STRING:
+        for (int i = 0; i < at(args[0] + 1); i++) printChar(at(args[0] + STRING_HEADER + i));
+        return 0;
+    case OUTPUT_PRINT_INT:    output << args[0]; return 0;
+    case OUTPUT_PRINTLN:      output << '\n'; return 0;
+
+    case KEYBOARD_KEY_PRESSED: return 0;
+    case KEYBOARD_READ_CHAR: {
+        int c = input != nullptr ? input->get() : EOF;
+        return static_cast<int16_t>(c == EOF ? 0 : c == '\n' ? NEWLINE : c);
+    }
+    case KEYBOARD_READ_LINE:  return newString(readLine(args[0]));
+    case KEYBOARD_READ_INT:   return static_cast<int16_t>(std::atoi(readLine(args[0]).c_str()));
+
+    case SYS_HALT:
+        halted = true;
+        return 0;
+    case SYS_ERROR:
+        throw std::runtime_error("Sys.error(" + std::to_string(args[0]) + ")");
+
+    // Инициализация, курсор, экран и ожидание в режиме без экрана ничего не делают
+    default:
+        return 0;
+    }
+}
@@ -0,0 +1,67 @@
+﻿#pragma once
+#include "VMInstruction.h"
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Исполнение VM-кода без эмулятора Hack. Функции всех классов
+// декодируются в плотный массив команд с разрешёнными переходами,
+// вызовами и адресами static, цикл исполнения - computed goto (GCC/Clang)
+// или switch. Классы ОС (CodeGenerator::isBuiltInClass), которых нет
+// среди загруженных, заменяются встроенными реализациями: вывод идёт
+// в поток, экран не рисуется, клавиатура читает из потока ввода.
+class VMInterpreter {
+public:
+    VMInterpreter();
+    ~VMInterpreter();
+
+    VMInterpreter(const VMInterpreter&) = delete;
+    VMInterpreter& operator=(const VMInterpreter&) = delete;
+
+    // Добавляет функции (содержимое .vm, .vmb или бандла). Класс функции,
+    // а с ним и её переменные static, определяется по имени "Класс.функция".
+    void load(std::vector<VMFunction> functions);
+
+    // Предел числа исполненных команд (0 - без предела)
+    void setInstructionLimit(uint64_t limit);
+
+    struct Result {
+        uint64_t instructions = 0;
+        int16_t returnValue = 0;    // Значение, возвращённое точкой входа
+        bool halted = false;        // Завершение через Sys.halt
+        double seconds = 0;
+    };
+
+    // Запускает Sys.init, если он загружен, иначе Main.main
+    Result run(std::ostream& output, std::istream* input = nullptr);
+
+    // Счётчики инструментированного кода после run(): класс -> число
+    // вызовов Profile.count(номер) из его функций по номерам
+    std::map<std::string, std::vector<uint64_t>> profileCounts() const;
+
+private:
+    struct Code;
+    struct Frame;
+
+    void link();
+    int16_t callNative(int native, int16_t* args, std::ostream& output, std::istream* input);
+    int16_t allocate(int size);
+    void deallocate(int16_t address);
+
+    std::map<std::string, std::vector<VMFunction>> classes;
+    uint64_t instructionLimit = 0;
+
+    std::vector<Code> code;
+    std::map<std::string, uint32_t> entries;    // Функция -> индекс в code
+    std::vector<std::string> profiledClasses;
+    std::vector<std::vector<uint64_t>> profile; // Счётчики Profile.count по классам
+    std::vector<int16_t> ram;
+    bool halted = false;
+
+    // Куча встроенного Memory: блок хранит размер в слове перед адресом
+    int heapTop = 0;
+    std::map<int, std::vector<int16_t>> freeBlocks;
+};
@@ -1,15 +1,35 @@
-#include "VMWriter.h"
+﻿#include "VMWriter.h"
+#include "AllocationTracker.h"
+#include "VMBytecode.h"
+#include <algorithm>
+#include <chrono>
 #include <stdexcept>
 #include <iostream>
 
-VMWriter::VMWriter(const std::string& filename) {
-    outputFile.open(filename);
+VMWriter::VMWriter(const std::string& filename, VMFormat format) : output(&outputFile) {
+    if (format == VMFormat::BYTECODE) {
+        bytecode = true;
+        output = nullptr;
+        functions = &bytecodeFunctions;
+        outputFile.open(filename, std::ios::binary);
+    }
+    else {
+        outputFile.open(filename);
+    }
     if (!outputFile.is_open()) {
         throw std::runtime_error("Failed to open output file: " + filename);
     }
     isFileOpen = true;
 }
 
+VMWriter::VMWriter(std::ostream& stream) : output(&stream) {
+    isFileOpen = true;
+}
+
+VMWriter::VMWriter(std::vector<VMFunction>& buffer) : output(nullptr), functions(&buffer) {
+    isFileOpen = true;
+}
+
 VMWriter::~VMWriter() {
     close();
 }
@@ -21,54 +41,186 @@ void VMWriter::checkFile() const {
 }
 
 void VMWriter::writePush(const std::string& segment, int index) {
-    checkFile();
-    outputFile << "push " << segment << " " << index << "\n";
+    emit({ VMOp::PUSH, segmentFromString(segment), index });
 }
 
 void VMWriter::writePop(const std::string& segment, int index) {
-    checkFile();
-    outputFile << "pop " << segment << " " << index << "\n";
+    emit({ VMOp::POP, segmentFromString(segment), index });
 }
 
 void VMWriter::writeArithmetic(const std::string& command) {
-    checkFile();
-    outputFile << command << "\n";
+    emit({ arithmeticFromString(command) });
 }
 
 void VMWriter::writeLabel(const std::string& label) {
-    checkFile();
-    outputFile << "label " << label << "\n";
+    emit({ VMOp::LABEL, Segment::NONE, 0, label });
 }
 
 void VMWriter::writeGoto(const std::string& label) {
-    checkFile();
-    outputFile << "goto " << label << "\n";
+    emit({ VMOp::GOTO, Segment::NONE, 0, label });
 }
 
 void VMWriter::writeIf(const std::string& label) {
-    checkFile();
-    outputFile << "if-goto " << label << "\n";
+    emit({ VMOp::IF_GOTO, Segment::NONE, 0, label });
+}
+
+void VMWriter::setDebugMode(bool mode) {
+    debugMode = mode;
 }
 
 void VMWriter::writeCall(const std::string& name, int nArgs) {
-    checkFile();
-    std::cout << "call " << name << " " << nArgs << "\n";
-    outputFile << "call " << name << " " << nArgs << "\n";
+    if (debugMode) {
+        std::cout << "call " << name << " " << nArgs << "\n";
+    }
+    emit({ VMOp::CALL, Segment::NONE, nArgs, name });
 }
 
 void VMWriter::writeFunction(const std::string& name, int nLocals) {
     checkFile();
-    outputFile << "function " << name << " " << nLocals << "\n";
+    flushFunction();
+    function.name = name;
+    function.nLocals = nLocals;
+    functionLine = sourceLine;
+    function.body.clear();
+    hasFunction = true;
 }
 
 void VMWriter::writeReturn() {
+    emit({ VMOp::RETURN });
+}
+
+void VMWriter::writeInstruction(const VMInstruction& instruction) {
+    emit(instruction);
+}
+
+void VMWriter::writeCounter(const std::string& site) {
+    writePush("constant", static_cast<int>(counters.size()));
+    writeCall("Profile.count", 1);
+    writePop("temp", 0);
+    counters.push_back(site);
+}
+
+const std::vector<std::string>& VMWriter::counterSites() const {
+    return counters;
+}
+
+size_t VMWriter::writeSavePoint() {
+    emit({ VMOp::NOP, Segment::LOCAL, -1 });
+    return function.body.size() - 1;
+}
+
+VMFunction& VMWriter::currentFunction() {
+    if (!hasFunction) {
+        throw std::runtime_error("VMWriter: No function in progress");
+    }
+    return function;
+}
+
+void VMWriter::emit(VMInstruction instruction) {
     checkFile();
-    outputFile << "return\n";
+    if (!hasFunction) {
+        if (output != nullptr) writeInstructionText(*output, instruction);
+        return;
+    }
+    if (instruction.line == 0) instruction.line = static_cast<uint32_t>(sourceLine);
+    function.body.push_back(std::move(instruction));
+}
+
+void VMWriter::setStatistics(FileStatistics* s) {
+    statistics = s;
+}
+
+FileStatistics* VMWriter::fileStatistics() const {
+    return statistics;
+}
+
+void VMWriter::setSourceLine(size_t line) {
+    sourceLine = line;
+}
+
+void VMWriter::setLineMap(const std::string& path, const std::string& sourceName) {
+    lineMapFile.open(path);
+    if (!lineMapFile.is_open()) {
+        throw std::runtime_error("Failed to open output file: " + path);
+    }
+    lineMap = "jackc-linemap 1\nsource " + sourceName + "\n";
+}
+
+// Команды без строки (добавленные оптимизатором) относятся к строке предыдущей
+void VMWriter::appendLineMap() {
+    lineMap += function.name;
+    size_t runLine = functionLine;
+    size_t runLength = 1;
+    auto endRun = [&]() {
+        long long delta = static_cast<long long>(runLine) - static_cast<long long>(mappedLine);
+        lineMap += " " + std::to_string(runLength) + "," + (delta >= 0 ? "+" : "") + std::to_string(delta);
+        mappedLine = runLine;
+    };
+    for (const auto& instruction : function.body) {
+        if (instruction.op == VMOp::NOP) continue;
+        if (instruction.line == 0 || instruction.line == runLine) {
+            runLength++;
+            continue;
+        }
+        endRun();
+        runLine = instruction.line;
+        runLength = 1;
+    }
+    endRun();
+    lineMap += "\n";
+}
+
+void VMWriter::flushFunction() {
+    if (!hasFunction) return;
+    checkFile();
+    AllocationScope scope(AllocationPhase::WRITER);
+
+    auto start = statistics != nullptr ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+    if (statistics != nullptr) {
+        statistics->instructions[static_cast<size_t>(VMOp::FUNCTION)]++;
+        for (const auto& instruction : function.body) {
+            if (instruction.op != VMOp::NOP) statistics->instructions[static_cast<size_t>(instruction.op)]++;
+        }
+    }
+
+    if (output != nullptr) {
+        writeFunctionText(*output, function);
+    }
+    if (lineMapFile.is_open()) {
+        appendLineMap();
+    }
+    if (functions != nullptr) {
+        // Точки сохранения CSE в буфер не попадают, как и в текст
+        std::erase_if(function.body, [](const VMInstruction& instruction) {
+            return instruction.op == VMOp::NOP;
+        });
+        functions->push_back(std::move(function));
+        function = VMFunction();
+    }
+    function.body.clear();
+    hasFunction = false;
+    if (statistics != nullptr) {
+        statistics->writeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
 }
 
 void VMWriter::close() {
     if (isFileOpen) {
-        outputFile.close();
+        flushFunction();
+        AllocationScope scope(AllocationPhase::WRITER);
+        auto start = statistics != nullptr ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        if (bytecode) outputFile << encodeBytecode(bytecodeFunctions);
+        if (statistics != nullptr && outputFile.is_open()) {
+            statistics->bytesWritten += static_cast<size_t>(std::max<std::streamoff>(0, outputFile.tellp()));
+        }
+        if (outputFile.is_open()) outputFile.close();
+        if (lineMapFile.is_open()) {
+            lineMapFile << lineMap;
+            lineMapFile.close();
+        }
+        if (statistics != nullptr) {
+            statistics->writeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
         isFileOpen = false;
     }
-}
\ No newline at end of file
+}
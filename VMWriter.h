@@ -1,12 +1,25 @@
 ﻿#pragma once
 #include <fstream>
+#include <ostream>
 #include <string>
 #include <unordered_map>
+#include <vector>
+#include "CompileStatistics.h"
+#include "VMInstruction.h"
+
+// Формат выходного файла: текст .vm или двоичный .vmb (VMBytecode.h)
+enum class VMFormat { TEXT, BYTECODE };
 
 class VMWriter {
 public:
-    // Конструктор: открывает выходной файл .vm
-    explicit VMWriter(const std::string& filename);
+    // Конструктор: открывает выходной файл .vm (или .vmb)
+    explicit VMWriter(const std::string& filename, VMFormat format = VMFormat::TEXT);
+
+    // Запись в поток (без файла)
+    explicit VMWriter(std::ostream& stream);
+
+    // Запись готовых функций в буфер команд (без текста)
+    explicit VMWriter(std::vector<VMFunction>& functions);
 
     // Деструктор: закрывает файл при необходимости
     ~VMWriter();
@@ -32,17 +45,72 @@ public:
     // Записывает вызов функции
     void writeCall(const std::string& name, int nArgs);
 
-    // Записывает объявление функции
+    // Записывает объявление функции (начинает буфер новой функции)
     void writeFunction(const std::string& name, int nLocals);
 
     // Записывает return
     void writeReturn();
 
+    // Записывает готовую команду (встраивание тела другой функции)
+    void writeInstruction(const VMInstruction& instruction);
+
+    // Счётчик исполнения места site (--instrument): вызов Profile.count(номер)
+    void writeCounter(const std::string& site);
+
+    // Места счётчиков файла по номерам
+    const std::vector<std::string>& counterSites() const;
+
+    // Ставит точку сохранения значения с вершины стека, возвращает её номер в теле функции
+    size_t writeSavePoint();
+
+    // Буфер текущей функции (ещё не записан в файл)
+    VMFunction& currentFunction();
+
+    // Записывает буфер текущей функции в файл
+    void flushFunction();
+
     // Закрывает выходной файл
     void close();
 
+    // Отладочный вывод записываемых вызовов
+    void setDebugMode(bool mode);
+
+    // Счётчики команд, байты и время записи (nullptr - не собирать)
+    void setStatistics(FileStatistics* statistics);
+    FileStatistics* fileStatistics() const;
+
+    // Строка исходника для следующих команд
+    void setSourceLine(size_t line);
+
+    // Карта строк рядом с выходным файлом (.vmmap): для каждой команды
+    // функции, начиная с самой команды function, - строка исходника.
+    // Строка функции - имя и серии "число,приращение": число команд подряд
+    // на одной строке и её отличие от строки предыдущей серии.
+    //   jackc-linemap 1
+    //   source Main.jack
+    //   Main.main 3,+4 2,+1 5,-1
+    void setLineMap(const std::string& path, const std::string& sourceName);
+
 private:
+    void emit(VMInstruction instruction);
+    void appendLineMap();
+
     std::ofstream outputFile;
+    std::ostream* output;
+    std::vector<VMFunction>* functions = nullptr;
+    // Двоичный файл пишется целиком при закрытии: таблица строк идёт перед кодом
+    bool bytecode = false;
+    std::vector<VMFunction> bytecodeFunctions;
     bool isFileOpen = false;
+    VMFunction function;
+    bool hasFunction = false;
+    bool debugMode = false;
+    std::vector<std::string> counters;
+    size_t sourceLine = 0;
+    size_t functionLine = 0;
+    std::ofstream lineMapFile;
+    std::string lineMap;
+    size_t mappedLine = 0;          // Строка последней серии в карте
+    FileStatistics* statistics = nullptr;
     void checkFile() const;
-};
\ No newline at end of file
+};
@@ -0,0 +1,216 @@
+﻿#include "CorpusGenerator.h"
+#include "CompilerOptions.h"
+#include "Hash.h"
+#include "JackCompiler.h"
+#include "JackTokenizer.h"
+#include "ProjectBuilder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Один замер: объём работы и время каждого повтора
+struct Measurement {
+    std::string name;
+    size_t files = 0;
+    size_t lines = 0;
+    size_t tokens = 0;
+    size_t bytes = 0;
+    std::vector<double> seconds;
+
+    double median() const {
+        std::vector<double> sorted = seconds;
+        std::sort(sorted.begin(), sorted.end());
+        size_t middle = sorted.size() / 2;
+        return sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+    }
+
+    double fastest() const {
+        return *std::min_element(seconds.begin(), seconds.end());
+    }
+};
+
+// Прогрев, затем repeat повторов. Скорости считаются по медиане:
+// она меньше минимума зависит от случайных задержек и лучше
+// воспроизводится между запусками.
+template <typename Body>
+void measure(Measurement& measurement, size_t repeat, Body&& body) {
+    body();
+    for (size_t i = 0; i < repeat; i++) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        measurement.seconds.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+size_t countTokens(const GeneratedClass& generated) {
+    JackTokenizer tokenizer(generated.name, generated.source);
+    size_t tokens = 0;
+    while (tokenizer.hasMoreTokens()) {
+        tokenizer.advance();
+        if (tokenizer.tokenType() != TokenType::UNKNOWN) tokens++;
+    }
+    return tokens;
+}
+
+void writeCorpus(const std::vector<GeneratedClass>& corpus, const fs::path& directory) {
+    fs::create_directories(directory);
+    for (const auto& generated : corpus) {
+        fs::path path = directory / (generated.name + ".jack");
+        std::ofstream out(path, std::ios::binary);
+        out << generated.source;
+        if (!out) {
+            throw std::runtime_error("Failed to open output file: " + path.string());
+        }
+    }
+}
+
+void printRow(const Measurement& measurement) {
+    double seconds = measurement.median();
+    std::cout << std::left << std::setw(12) << measurement.name << std::right << std::fixed
+        << std::setprecision(2) << std::setw(10) << seconds * 1000.0
+        << std::setw(10) << measurement.fastest() * 1000.0
+        << std::setprecision(0) << std::setw(14) << measurement.tokens / seconds
+        << std::setw(12) << measurement.lines / seconds
+        << std::setprecision(1) << std::setw(10) << measurement.files / seconds
+        << std::setprecision(2) << std::setw(9) << measurement.bytes / seconds / 1e6 << "\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    CorpusOptions corpusOptions;
+    CompilerOptions options;
+    size_t repeat = 5;
+    std::string workDirectory;
+    std::string corpusDirectory;    // --write-corpus: только сгенерировать корпус
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--classes" && hasValue) corpusOptions.classes = std::stoul(argv[++i]);
+            else if (arg == "--subroutines" && hasValue) corpusOptions.subroutines = std::stoul(argv[++i]);
+            else if (arg == "--statements" && hasValue) corpusOptions.statements = std::stoul(argv[++i]);
+            else if (arg == "--depth" && hasValue) corpusOptions.depth = std::stoul(argv[++i]);
+            else if (arg == "--strings" && hasValue) corpusOptions.stringDensity = std::stod(argv[++i]);
+            else if (arg == "--comments" && hasValue) corpusOptions.commentDensity = std::stod(argv[++i]);
+            else if (arg == "--fan-out" && hasValue) corpusOptions.fanOut = std::stoul(argv[++i]);
+            else if (arg == "--seed" && hasValue) corpusOptions.seed = std::stoull(argv[++i]);
+            else if (arg == "--repeat" && hasValue) repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+            else if (arg == "--work-dir" && hasValue) workDirectory = argv[++i];
+            else if (arg == "--write-corpus" && hasValue) corpusDirectory = argv[++i];
+            else if (arg == "--ast") options.buildSyntaxTree = true;
+            else {
+                std::cerr << "Usage: " << argv[0] << " [--classes N] [--subroutines N] [--statements N] [--depth N]"
+                    << " [--strings P] [--comments P] [--fan-out N] [--seed N] [--repeat N] [--ast]"
+                    << " [--work-dir DIR] [--write-corpus DIR]\n";
+                return 1;
+            }
+        }
+
+        std::vector<GeneratedClass> corpus = generateCorpus(corpusOptions);
+        if (!corpusDirectory.empty()) {
+            writeCorpus(corpus, corpusDirectory);
+            std::cout << "Corpus: " << corpus.size() << " class(es) -> " << corpusDirectory << "\n";
+            return 0;
+        }
+
+        // Объём корпуса и его хеш: одинаковый хеш - одинаковый вход
+        Measurement total;
+        uint64_t corpusHash = 0;
+        for (const auto& generated : corpus) {
+            total.files++;
+            total.bytes += generated.source.size();
+            total.lines += static_cast<size_t>(std::count(generated.source.begin(), generated.source.end(), '\n'));
+            total.tokens += countTokens(generated);
+            corpusHash = xxhash64(generated.source, corpusHash);
+        }
+
+        char hash[32];
+        std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(corpusHash));
+        std::cout << "Corpus " << hash << ": " << total.files << " files, " << total.lines << " lines, "
+            << total.tokens << " tokens, " << total.bytes << " bytes (seed " << corpusOptions.seed << ")\n"
+            << "Compiler: " << options.signature() << (options.buildSyntaxTree ? " ast" : "")
+            << ", " << repeat << " repeat(s), median\n\n";
+
+        std::vector<JackSource> sources;
+        for (const auto& generated : corpus) {
+            sources.push_back({ generated.name, generated.source });
+        }
+
+        // Только лексер
+        Measurement tokenizer = total;
+        tokenizer.name = "tokenizer";
+        measure(tokenizer, repeat, [&] {
+            for (const auto& generated : corpus) {
+                JackTokenizer lexer(generated.name, generated.source);
+                while (lexer.hasMoreTokens()) lexer.advance();
+            }
+        });
+
+        // Весь компилятор в памяти, без файловой системы
+        Measurement compiler = total;
+        compiler.name = "compiler";
+        CompilerWorkspace workspace;
+        measure(compiler, repeat, [&] {
+            CompilationResult result = compileJack(sources, workspace, options);
+            if (!result.succeeded()) {
+                const Diagnostic& diagnostic = result.diagnostics.front();
+                throw std::runtime_error("Corpus does not compile: " + diagnostic.source + ".jack:" +
+                    std::to_string(diagnostic.line) + ": " + diagnostic.message);
+            }
+        });
+
+        // Сборка каталога: чтение .jack, компиляция и запись .vm
+        fs::path directory = workDirectory.empty()
+            ? fs::temp_directory_path() / (std::string("jackc-bench-") + hash) : fs::path(workDirectory);
+        writeCorpus(corpus, directory);
+        std::vector<fs::path> jackFiles;
+        for (const auto& generated : corpus) {
+            jackFiles.push_back(directory / (generated.name + ".jack"));
+        }
+        Measurement project = total;
+        project.name = "directory";
+        {
+            // ProjectBuilder сообщает о каждом файле; в замер вывод не входит
+            std::ostringstream log;
+            std::streambuf* console = std::cout.rdbuf(log.rdbuf());
+            try {
+                measure(project, repeat, [&] {
+                    log.str(std::string());
+                    ProjectBuilder builder(options, "", false);
+                    builder.build(jackFiles);
+                });
+            }
+            catch (...) {
+                std::cout.rdbuf(console);
+                throw;
+            }
+            std::cout.rdbuf(console);
+        }
+
+        std::cout << std::left << std::setw(12) << "benchmark" << std::right << std::setw(10) << "ms"
+            << std::setw(10) << "min ms" << std::setw(14) << "tokens/s" << std::setw(12) << "lines/s"
+            << std::setw(10) << "files/s" << std::setw(9) << "MB/s" << "\n";
+        printRow(tokenizer);
+        printRow(compiler);
+        printRow(project);
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+﻿#include "CorpusGenerator.h"
+#include <cstdio>
+
+namespace {
+
+// splitmix64: простой и одинаковый везде генератор
+class Random {
+public:
+    explicit Random(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    // [0, bound)
+    size_t below(size_t bound) {
+        return bound == 0 ? 0 : static_cast<size_t>(next() % bound);
+    }
+
+    bool chance(double probability) {
+        return static_cast<double>(next() >> 11) * (1.0 / 9007199254740992.0) < probability;
+    }
+
+private:
+    uint64_t state;
+};
+
+const char* const WORDS[] = {
+    "alpha", "beta", "gamma", "delta", "value", "count", "index", "total",
+    "buffer", "screen", "result", "square", "ball", "paddle", "score", "level",
+};
+const size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+const char* const VARIABLES[] = { "a", "b", "x0", "x1", "x2", "x3" };
+const size_t VARIABLE_COUNT = sizeof(VARIABLES) / sizeof(VARIABLES[0]);
+
+std::string className(size_t index) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "C%04zu", index);
+    return name;
+}
+
+class ClassGenerator {
+public:
+    ClassGenerator(const CorpusOptions& options, size_t index, Random& random)
+        : options(options), index(index), random(random) {}
+
+    std::string generate() {
+        out += "// Generated class " + className(index) + "\n";
+        out += "class " + className(index) + " {\n";
+        out += "    static int calls;\n\n";
+        for (size_t i = 0; i < options.subroutines; i++) {
+            subroutine(i);
+        }
+        out += "}\n";
+        return std::move(out);
+    }
+
+private:
+    void subroutine(size_t number) {
+        out += "    function int f" + std::to_string(number) + "(int a, int b) {\n";
+        out += "        var int x0, x1, x2, x3;\n";
+        out += "        var String text;\n";
+        out += "        let x0 = a;\n";
+        out += "        let calls = calls + 1;\n";
+
+        // Вызовы других классов распределяются по телу функции
+        size_t calls = index == 0 ? 0 : options.fanOut;
+        for (size_t i = 0; i < options.statements; i++) {
+            bool call = calls > 0 && random.below(options.statements - i) < calls;
+            if (call) calls--;
+            statement(2, options.depth, call);
+        }
+        out += "        return x0 + x1;\n";
+        out += "    }\n\n";
+    }
+
+    void statement(size_t indent, size_t depth, bool call) {
+        std::string pad(indent * 4, ' ');
+        if (random.chance(options.commentDensity)) {
+            if (random.below(2) == 0) {
+                out += pad + "// " + words(3 + random.below(6)) + "\n";
+            }
+            else {
+                out += pad + "/* " + words(4 + random.below(10)) + " */\n";
+            }
+        }
+
+        if (call) {
+            size_t target = random.below(index);
+            size_t function = random.below(options.subroutines);
+            out += pad + "let " + variable(true) + " = " + className(target) + ".f" +
+                std::to_string(function) + "(" + expression(1) + ", " + expression(1) + ");\n";
+            return;
+        }
+        if (random.chance(options.stringDensity)) {
+            if (random.below(2) == 0) {
+                out += pad + "let text = \"" + words(1 + random.below(5)) + "\";\n";
+                out += pad + "let x3 = text.length();\n";
+                out += pad + "do text.dispose();\n";
+            }
+            else {
+                out += pad + "do Output.printString(\"" + words(1 + random.below(5)) + "\");\n";
+            }
+            return;
+        }
+
+        size_t kind = depth > 0 ? random.below(6) : 0;
+        if (kind == 4) {
+            out += pad + "if (" + condition() + ") {\n";
+            block(indent + 1, depth - 1);
+            if (random.below(2) == 0) {
+                out += pad + "}\n" + pad + "else {\n";
+                block(indent + 1, depth - 1);
+            }
+            out += pad + "}\n";
+        }
+        else if (kind == 5) {
+            // Счётчик увеличивается первым, цикл всегда конечен
+            std::string counter = "x" + std::to_string(random.below(3));
+            out += pad + "while (" + counter + " < " + std::to_string(2 + random.below(30)) + ") {\n";
+            out += pad + "    let " + counter + " = " + counter + " + 1;\n";
+            block(indent + 1, depth - 1);
+            out += pad + "}\n";
+        }
+        else {
+            out += pad + "let " + variable(true) + " = " + expression(2) + ";\n";
+        }
+    }
+
+    void block(size_t indent, size_t depth) {
+        size_t count = 1 + random.below(3);
+        for (size_t i = 0; i < count; i++) {
+            statement(indent, depth, false);
+        }
+    }
+
+    std::string expression(size_t depth) {
+        if (depth == 0 || random.below(3) == 0) {
+            return term();
+        }
+        static const char* const OPERATORS[] = { " + ", " - ", " * ", " & ", " | " };
+        std::string result = term() + OPERATORS[random.below(5)] + "(" + expression(depth - 1) + ")";
+        if (random.below(4) == 0) {
+            result = "-(" + result + ")";
+        }
+        return result;
+    }
+
+    std::string term() {
+        if (random.below(3) == 0) {
+            return std::to_string(random.below(1000));
+        }
+        return variable(false);
+    }
+
+    std::string condition() {
+        static const char* const COMPARISONS[] = { " < ", " > ", " = " };
+        std::string result = "(" + expression(1) + ")" + COMPARISONS[random.below(3)] + term();
+        if (random.below(4) == 0) {
+            result = "~(" + result + ")";
+        }
+        return result;
+    }
+
+    // Цели присваивания - только локальные переменные
+    std::string variable(bool assignable) {
+        if (assignable) return VARIABLES[2 + random.below(VARIABLE_COUNT - 2)];
+        return VARIABLES[random.below(VARIABLE_COUNT)];
+    }
+
+    std::string words(size_t count) {
+        std::string result;
+        for (size_t i = 0; i < count; i++) {
+            if (i > 0) result += ' ';
+            result += WORDS[random.below(WORD_COUNT)];
+        }
+        return result;
+    }
+
+    const CorpusOptions& options;
+    size_t index;
+    Random& random;
+    std::string out;
+};
+
+}
+
+std::vector<GeneratedClass> generateCorpus(const CorpusOptions& options) {
+    std::vector<GeneratedClass> corpus;
+    for (size_t i = 0; i < options.classes; i++) {
+        // Свой поток чисел у каждого класса: размер одного класса
+        // не сдвигает содержимое следующих
+        Random random(options.seed * 0x100000001B3ull + i);
+        corpus.push_back({ className(i), ClassGenerator(options, i, random).generate() });
+    }
+    return corpus;
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Параметры синтетического корпуса Jack для бенчмарков
+struct CorpusOptions {
+    size_t classes = 40;
+    size_t subroutines = 12;        // Функций в классе
+    size_t statements = 24;         // Операторов в теле функции (верхний уровень)
+    size_t depth = 3;               // Вложенность if/while
+    double stringDensity = 0.15;    // Доля операторов со строковым литералом
+    double commentDensity = 0.25;   // Доля операторов с комментарием перед ними
+    size_t fanOut = 2;              // Вызовов функций других классов на функцию
+    uint64_t seed = 1;
+};
+
+struct GeneratedClass {
+    std::string name;
+    std::string source;
+};
+
+// Корпус определяется только параметрами: генератор не использует
+// std::random_device и распределения стандартной библиотеки, поэтому
+// на любой платформе и компиляторе получаются те же байты. Класс
+// вызывает функции только классов с меньшим номером, так что корпус
+// компилируется в порядке имён и не содержит рекурсии.
+std::vector<GeneratedClass> generateCorpus(const CorpusOptions& options);
@@ -0,0 +1,74 @@
+# Повторная сборка с --interfaces или --cache после правки одного класса
+# должна дать те же .vm, что и чистая сборка тех же исходников.
+# Запуск: cmake -DJACKC=<путь к jackc> -DWORK_DIR=<каталог> -P IncrementalBuild.cmake
+
+if(NOT JACKC OR NOT WORK_DIR)
+    message(FATAL_ERROR "JACKC and WORK_DIR must be set")
+endif()
+
+# Aaa компилируется раньше Zzz, поэтому при чистой сборке не знает,
+# что Zzz.twice чистая, и не выносит её вызов из цикла
+set(AAA_V1 "class Aaa {
+    function int sum(int a) {
+        var int i, s;
+        let i = 0;
+        let s = 0;
+        while (i < 3) {
+            let s = s + Zzz.twice(a);
+            let i = i + 1;
+        }
+        return s;
+    }
+}
+")
+string(REPLACE "let s = 0;" "let s = 1;" AAA_V2 "${AAA_V1}")
+set(ZZZ "class Zzz {
+    function int twice(int x) { return x + x; }
+}
+")
+set(MAIN "class Main {
+    function void main() {
+        do Output.printInt(Aaa.sum(Zzz.twice(5)));
+        return;
+    }
+}
+")
+
+function(write_sources dir aaa)
+    file(MAKE_DIRECTORY ${dir})
+    file(WRITE ${dir}/Aaa.jack "${aaa}")
+    file(WRITE ${dir}/Main.jack "${MAIN}")
+    file(WRITE ${dir}/Zzz.jack "${ZZZ}")
+endfunction()
+
+function(compile dir)
+    execute_process(COMMAND ${JACKC} -O2 ${ARGN} ${dir}
+        RESULT_VARIABLE result OUTPUT_QUIET ERROR_VARIABLE error)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "jackc failed on ${dir}: ${error}")
+    endif()
+endfunction()
+
+file(REMOVE_RECURSE ${WORK_DIR})
+write_sources(${WORK_DIR}/clean "${AAA_V2}")
+compile(${WORK_DIR}/clean)
+
+foreach(mode interfaces cache)
+    set(dir ${WORK_DIR}/${mode})
+    if(mode STREQUAL "interfaces")
+        set(flags --interfaces)
+    else()
+        set(flags --cache ${WORK_DIR}/cache-entries)
+    endif()
+    write_sources(${dir} "${AAA_V1}")
+    compile(${dir} ${flags})
+    file(WRITE ${dir}/Aaa.jack "${AAA_V2}")
+    compile(${dir} ${flags})
+    foreach(class Aaa Main Zzz)
+        execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files
+            ${WORK_DIR}/clean/${class}.vm ${dir}/${class}.vm RESULT_VARIABLE different)
+        if(different)
+            message(FATAL_ERROR "${class}.vm after an incremental build (${mode}) differs from a clean build")
+        endif()
+    endforeach()
+endforeach()